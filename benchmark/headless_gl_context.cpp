@@ -0,0 +1,84 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#include "headless_gl_context.hpp"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+
+#include <cstring>
+
+namespace {
+bool hasExtension(EGLDisplay display, const char *name) {
+    const char *extensions = eglQueryString(display, EGL_EXTENSIONS);
+    return extensions != nullptr && std::strstr(extensions, name) != nullptr;
+}
+
+EGLDisplay initializeDisplay() {
+    auto get_platform_display =
+            reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (get_platform_display != nullptr && hasExtension(EGL_NO_DISPLAY, "EGL_MESA_platform_surfaceless")) {
+        EGLDisplay display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr)) return display;
+    }
+    EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr)) return display;
+    return EGL_NO_DISPLAY;
+}
+}
+
+HeadlessGLContext::HeadlessGLContext() {
+    EGLDisplay display = initializeDisplay();
+    if (display == EGL_NO_DISPLAY) {
+        error_ = "Failed to initialize an EGL display.";
+        return;
+    }
+    display_ = display;
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        error_ = "EGL does not support desktop OpenGL.";
+        return;
+    }
+    const EGLint config_attributes[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                                        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+                                        EGL_NONE};
+    EGLConfig config;
+    EGLint config_count = 0;
+    if (!eglChooseConfig(display, config_attributes, &config, 1, &config_count) || config_count == 0) {
+        error_ = "No EGL config with OpenGL and pbuffer support.";
+        return;
+    }
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, nullptr);
+    if (context == EGL_NO_CONTEXT) {
+        error_ = "Failed to create the EGL context.";
+        return;
+    }
+    if (!hasExtension(display, "EGL_KHR_surfaceless_context")) {
+        const EGLint pbuffer_attributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+        surface_ = eglCreatePbufferSurface(display, config, pbuffer_attributes);
+        if (surface_ == EGL_NO_SURFACE) {
+            eglDestroyContext(display, context);
+            error_ = "Failed to create a pbuffer for a context without surfaceless support.";
+            return;
+        }
+    }
+    context_ = context;
+}
+
+HeadlessGLContext::~HeadlessGLContext() {
+    if (display_ == nullptr) return;
+    eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (surface_ != nullptr) eglDestroySurface(display_, surface_);
+    if (context_ != nullptr) eglDestroyContext(display_, context_);
+}
+
+void HeadlessGLContext::makeCurrent() {
+    EGLSurface surface = surface_ == nullptr ? EGL_NO_SURFACE : static_cast<EGLSurface>(surface_);
+    eglMakeCurrent(display_, surface, surface, context_);
+}
+
+std::string HeadlessGLContext::renderer() const {
+    const auto *renderer = reinterpret_cast<const char *>(glGetString(GL_RENDERER));
+    return renderer == nullptr ? std::string() : std::string(renderer);
+}
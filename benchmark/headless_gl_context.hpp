@@ -0,0 +1,43 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#ifndef HEADLESS_GL_CONTEXT_HPP
+#define HEADLESS_GL_CONTEXT_HPP
+
+#include <string>
+
+/*!
+ * A desktop OpenGL context without a window system, created with EGL on the surfaceless platform (EGL_MESA_platform
+ * surfaceless) or, if that is not available, the default display. Stands in for Ogre's context in the benchmarks.
+ * With Mesa, LIBGL_ALWAYS_SOFTWARE=1 selects llvmpipe for reproducible numbers on machines without a GPU.
+ */
+class HeadlessGLContext {
+public:
+    HeadlessGLContext();
+
+    ~HeadlessGLContext();
+
+    HeadlessGLContext(const HeadlessGLContext &) = delete;
+
+    HeadlessGLContext &operator=(const HeadlessGLContext &) = delete;
+
+    bool isValid() const { return context_ != nullptr; }
+
+    //! The reason if the context could not be created.
+    const std::string &error() const { return error_; }
+
+    void makeCurrent();
+
+    //! The GL_RENDERER string, e.g., "llvmpipe (LLVM 15.0.7, 256 bits)". Requires the context to be current.
+    std::string renderer() const;
+
+private:
+    void *display_ = nullptr;
+    void *context_ = nullptr;
+    //! A 1x1 pbuffer if the implementation does not support surfaceless contexts.
+    void *surface_ = nullptr;
+    std::string error_;
+};
+
+#endif //HEADLESS_GL_CONTEXT_HPP
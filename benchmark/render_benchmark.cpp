@@ -0,0 +1,262 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+// Headless benchmark of the overlay render path. QOpenGLWrapper::draw() is driven in a loop with a layer that changes
+// every frame, so each frame is painted, read back and uploaded into the texture of a headless EGL context that
+// stands in for Ogre's context. Runs without rviz2 and a GPU, e.g., on Mesa's llvmpipe:
+//
+//   LIBGL_ALWAYS_SOFTWARE=1 EGL_PLATFORM=surfaceless QT_QPA_PLATFORM=minimalegl overlay_test_render_benchmark
+//
+// Qt needs a platform plugin with OpenGL support for its offscreen context: minimalegl without a display server or
+// the default xcb plugin, e.g., in an Xvfb.
+//
+// Options:
+//   --frames N     Measured frames per size (default 100).
+//   --warmup N     Frames drawn before measuring (default 10).
+//   --size WxH     Measure only the given size. May be repeated. Default: 200x200 up to 3840x2160.
+//   --json PATH    Also write the results as JSON, e.g., for test/check_benchmark_regression.py.
+//   --max-allocations N
+//                  Fail if a measured frame made more than N heap allocations outside of the layer painting, e.g., 0 to
+//                  check that draw() does not allocate once warmed up. Requires the hector_timeit allocation hooks.
+
+#include "headless_gl_context.hpp"
+#include "allocation_tracker.hpp"
+#include "concurrent_timer.hpp"
+#include "overlay_layer.hpp"
+#include "qopengl_wrapper.hpp"
+
+#include <QGuiApplication>
+#include <QPainter>
+
+#include <GL/gl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+struct Size {
+    int width;
+    int height;
+};
+
+//! Painter layer that changes every frame.
+class BenchmarkLayer : public OverlayLayer {
+public:
+    explicit BenchmarkLayer(const QRect &geometry) : OverlayLayer(geometry) {}
+
+    bool isDirty() const override { return true; }
+
+    void paint(QPainter &painter) override {
+        ++frame_;
+        const int width = geometry().width(), height = geometry().height();
+        painter.fillRect(0, 0, width, height, QColor(0, 0, 0, 100));
+        for (int i = 0; i < 16; ++i) {
+            const int x = (frame_ * 7 + i * width / 16) % width;
+            painter.fillRect(x, i * height / 16, width / 32 + 1, height / 16 + 1,
+                             QColor::fromHsv((frame_ * 3 + i * 20) % 360, 200, 255, 200));
+        }
+        painter.setPen(Qt::white);
+        painter.drawText(8, 20, QStringLiteral("frame %1").arg(frame_));
+    }
+
+private:
+    int frame_ = 0;
+};
+
+struct SizeResult {
+    hector_timeit::RunStatistics frame;
+    hector_timeit::RunStatistics paint;
+    hector_timeit::RunStatistics readback;
+    hector_timeit::RunStatistics upload;
+    uint64_t uploaded_bytes = 0;
+    uint64_t allocations = 0;
+    //! Maximum of the allocations of a frame outside of the layer painting, see FrameStatistics::paint_allocations.
+    uint64_t max_draw_allocations = 0;
+    double seconds = 0;
+};
+
+std::unordered_map<size_t, hector_timeit::RunStatistics> timerSnapshot() {
+    std::unordered_map<size_t, hector_timeit::RunStatistics> result;
+    hector_timeit::ConcurrentTimer::forEach([&](const hector_timeit::ConcurrentTimer &timer) {
+        result.emplace(timer.id(), timer.getRunStatistics());
+    });
+    return result;
+}
+
+SizeResult run(HeadlessGLContext &gl, const Size &size, int warmup, int frames) {
+    gl.makeCurrent();
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size.width, size.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    SizeResult result;
+    bool measuring = false;
+    QOpenGLWrapper wrapper(size.width, size.height, texture);
+    wrapper.addLayer(std::make_shared<BenchmarkLayer>(QRect(0, 0, size.width, size.height)));
+    wrapper.setFrameCallback([&](const QOpenGLWrapper::FrameStatistics &stats) {
+        if (!measuring) return;
+        result.frame.add(stats.frame_time);
+        result.paint.add(stats.paint_time);
+        result.readback.add(stats.readback_time);
+        result.upload.add(stats.upload_time);
+        result.uploaded_bytes += stats.uploaded_bytes;
+        result.allocations += stats.allocations;
+        result.max_draw_allocations =
+                std::max(result.max_draw_allocations, stats.allocations - stats.paint_allocations);
+    });
+    for (int i = 0; i < warmup; ++i) wrapper.draw();
+    glFinish();
+
+    measuring = true;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; ++i) {
+        wrapper.draw();
+        // Include the GPU work of the upload, the wrapper only waits for the readback
+        glFinish();
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    glDeleteTextures(1, &texture);
+    return result;
+}
+
+double ms(double nanoseconds) { return nanoseconds / 1e6; }
+
+void printRow(const Size &size, const SizeResult &result) {
+    const double frames = std::max<uint64_t>(1, result.frame.count());
+    std::printf("%5dx%-5d %8.1f %9.1f %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f %8.1f %8llu\n", size.width, size.height,
+                result.frame.count() / result.seconds, result.uploaded_bytes / result.seconds / 1e6,
+                ms(result.frame.percentile(50)), ms(result.frame.percentile(99)), ms(result.frame.max()),
+                ms(result.paint.mean()), ms(result.readback.mean()), ms(result.upload.mean()),
+                result.allocations / frames, static_cast<unsigned long long>(result.max_draw_allocations));
+}
+
+//! Writes the metrics compared by test/check_benchmark_regression.py. Times in milliseconds.
+bool writeJson(const std::string &path, const std::string &renderer, int frames,
+               const std::vector<std::pair<Size, SizeResult>> &results) {
+    std::ofstream stream(path);
+    if (!stream) return false;
+    std::string escaped;
+    for (char c : renderer) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        escaped += c;
+    }
+    stream << "{\n  \"renderer\": \"" << escaped << "\",\n  \"frames\": " << frames << ",\n  \"results\": {";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Size &size = results[i].first;
+        const SizeResult &result = results[i].second;
+        stream << (i == 0 ? "" : ",") << "\n    \"" << size.width << "x" << size.height << "\": {"
+               << "\"fps\": " << result.frame.count() / result.seconds
+               << ", \"mb_per_s\": " << result.uploaded_bytes / result.seconds / 1e6
+               << ", \"frame_p50_ms\": " << ms(result.frame.percentile(50))
+               << ", \"frame_p99_ms\": " << ms(result.frame.percentile(99))
+               << ", \"paint_ms\": " << ms(result.paint.mean())
+               << ", \"readback_ms\": " << ms(result.readback.mean())
+               << ", \"upload_ms\": " << ms(result.upload.mean()) << "}";
+    }
+    // Not a timing, hence, not in results where the regression check compares every metric against its baseline
+    const bool hooks = hector_timeit::AllocationTracker::isAvailable();
+    stream << "\n  },\n  \"allocation_hooks\": " << (hooks ? "true" : "false") << ",\n  \"max_draw_allocations\": {";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Size &size = results[i].first;
+        stream << (i == 0 ? "" : ",") << "\n    \"" << size.width << "x" << size.height
+               << "\": " << results[i].second.max_draw_allocations;
+    }
+    stream << "\n  }\n}\n";
+    return static_cast<bool>(stream);
+}
+
+bool parseSize(const char *text, Size &size) {
+    return std::sscanf(text, "%dx%d", &size.width, &size.height) == 2 && size.width > 0 && size.height > 0;
+}
+}
+
+int main(int argc, char **argv) {
+    QGuiApplication app(argc, argv);
+    int frames = 100, warmup = 10;
+    long max_allocations = -1;
+    std::vector<Size> sizes;
+    std::string json_path;
+    for (int i = 1; i < argc; ++i) {
+        Size size{};
+        if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            warmup = std::max(0, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc && parseSize(argv[i + 1], size)) {
+            sizes.push_back(size);
+            ++i;
+        } else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--max-allocations") == 0 && i + 1 < argc) {
+            max_allocations = std::max(0L, std::atol(argv[++i]));
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--frames N] [--warmup N] [--size WxH]... [--json PATH]"
+                      << " [--max-allocations N]" << std::endl;
+            return 1;
+        }
+    }
+    if (sizes.empty()) {
+        sizes = {{200, 200}, {640, 480}, {1280, 720}, {1920, 1080}, {2560, 1440}, {3840, 2160}};
+    }
+
+    HeadlessGLContext gl;
+    if (!gl.isValid()) {
+        std::cerr << gl.error() << std::endl;
+        return 1;
+    }
+    if (max_allocations >= 0 && !hector_timeit::AllocationTracker::isAvailable()) {
+        std::cerr << "--max-allocations requires the hector_timeit allocation hooks to be linked." << std::endl;
+        return 1;
+    }
+    gl.makeCurrent();
+    std::cout << "Renderer: " << gl.renderer() << ", " << frames << " frame(s) per size" << std::endl;
+    std::cout << "Times in ms, stage times are CPU wall time means, gpu_* timers follow each row." << std::endl;
+    std::cout << "allocs: mean allocations per frame, max_draw: most allocations of a frame outside of painting."
+              << std::endl;
+    std::printf("%-11s %8s %9s %9s %9s %9s %9s %9s %9s %8s %8s\n", "Size", "FPS", "MB/s", "p50", "p99", "max", "paint",
+                "readback", "upload", "allocs", "max_draw");
+    std::vector<std::pair<Size, SizeResult>> results;
+    for (const Size &size : sizes) {
+        const auto before = timerSnapshot();
+        results.emplace_back(size, run(gl, size, warmup, frames));
+        const SizeResult &result = results.back().second;
+        printRow(size, result);
+        hector_timeit::ConcurrentTimer::forEach([&](const hector_timeit::ConcurrentTimer &timer) {
+            if (timer.name().compare(0, 4, "gpu_") != 0) return;
+            auto previous = before.find(timer.id());
+            const hector_timeit::RunStatistics window =
+                    previous == before.end() ? timer.getRunStatistics()
+                                             : timer.getRunStatistics().since(previous->second);
+            if (window.count() == 0) return;
+            std::printf("            %-14s %9.3f mean %9.3f p99\n", timer.name().c_str(), ms(window.mean()),
+                        ms(window.percentile(99)));
+        });
+    }
+    if (!json_path.empty() && !writeJson(json_path, gl.renderer(), frames, results)) {
+        std::cerr << "Failed to write " << json_path << std::endl;
+        return 1;
+    }
+    if (max_allocations >= 0) {
+        bool exceeded = false;
+        for (const auto &entry : results) {
+            if (entry.second.max_draw_allocations <= static_cast<uint64_t>(max_allocations)) continue;
+            std::cerr << entry.first.width << "x" << entry.first.height << ": a frame made "
+                      << entry.second.max_draw_allocations << " allocation(s) outside of painting, at most "
+                      << max_allocations << " allowed." << std::endl;
+            exceeded = true;
+        }
+        if (exceeded) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,144 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+// Overhead of hector_timeit itself: the floor every timed block adds per clock policy, the cost of finishing a run
+// for each run history and of printing large histories. Run, e.g., with:
+//
+//   overlay_test_timer_benchmark --benchmark_filter=EmptyTimeBlock
+
+#include "allocation_tracker.hpp"
+#include "concurrent_timer.hpp"
+#include "timer.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+namespace {
+using hector_timeit::BasicTimer;
+using hector_timeit::TimerBase;
+
+template<typename Clock>
+void BM_EmptyTimeBlock(benchmark::State &state) {
+    BasicTimer<Clock> timer("empty", TimerBase::Default, false, false, TimerBase::Streaming);
+    for (auto _ : state) {
+        hector_timeit::TimeBlock<Clock> block(timer);
+    }
+}
+
+//! Start and stop without finishing the run, i.e., accumulating into the same run.
+template<typename Clock>
+void BM_StartStop(benchmark::State &state) {
+    BasicTimer<Clock> timer("start_stop", TimerBase::Default, false, false, TimerBase::Streaming);
+    for (auto _ : state) {
+        timer.start();
+        timer.stop();
+    }
+}
+
+template<typename Clock>
+void BM_ClockNow(benchmark::State &state) {
+    for (auto _ : state) benchmark::DoNotOptimize(Clock::now());
+}
+
+void BM_EmptyConcurrentTimeBlock(benchmark::State &state) {
+    static hector_timeit::ConcurrentTimer timer("empty_concurrent", TimerBase::Default, false);
+    for (auto _ : state) {
+        hector_timeit::ConcurrentTimeBlock block(timer);
+    }
+}
+
+//! Empty block with the TraceRecorder enabled.
+void BM_EmptyTimeBlockTraced(benchmark::State &state) {
+    hector_timeit::TraceRecorder::enable();
+    hector_timeit::Timer timer("traced", TimerBase::Default, false, false, TimerBase::Streaming);
+    for (auto _ : state) {
+        hector_timeit::TimeBlock<hector_timeit::ChronoClock> block(timer);
+    }
+    hector_timeit::TraceRecorder::disable();
+}
+
+void BM_EmptyTimeBlockPerfCounters(benchmark::State &state) {
+    hector_timeit::Timer timer("perf", TimerBase::Default, false, false, TimerBase::Streaming);
+    if (!timer.enablePerfCounters()) {
+        state.SkipWithError("No perf_event counters available.");
+        return;
+    }
+    const hector_timeit::PerfCounters &counters = *timer.perfCounters();
+    state.SetLabel(counters.isHardware() ? "hardware" : counters.countsKernel() ? "software" : "software, user space");
+    for (auto _ : state) {
+        hector_timeit::TimeBlock<hector_timeit::ChronoClock> block(timer);
+    }
+}
+
+void BM_EmptyTimeBlockAllocationTracking(benchmark::State &state) {
+    hector_timeit::Timer timer("allocations", TimerBase::Default, false, false, TimerBase::Streaming);
+    // Without the hooks this measures the check only
+    state.SetLabel(timer.enableAllocationTracking() ? "hooks" : "no hooks");
+    for (auto _ : state) {
+        hector_timeit::TimeBlock<hector_timeit::ChronoClock> block(timer);
+    }
+}
+
+/*!
+ * Cost of finishing a run, reset(true), if the timer already holds state.range(0) runs in the given history.
+ * KeepAll amortizes the growth of its vectors, the reservoir replaces random samples once it is full.
+ */
+void BM_ResetNewRun(benchmark::State &state) {
+    const auto history = static_cast<TimerBase::RunHistory>(state.range(1));
+    hector_timeit::Timer timer("reset", TimerBase::Default, false, false, history);
+    for (long i = 0; i < state.range(0); ++i) {
+        timer.start();
+        timer.stop();
+        timer.reset(true);
+    }
+    for (auto _ : state) {
+        timer.start();
+        timer.stop();
+        timer.reset(true);
+    }
+}
+
+//! Formatting the statistics of state.range(0) runs in the given history.
+void BM_ToString(benchmark::State &state) {
+    const auto history = static_cast<TimerBase::RunHistory>(state.range(1));
+    hector_timeit::Timer timer("to_string", TimerBase::Default, false, false, history);
+    for (long i = 0; i < state.range(0); ++i) {
+        timer.start();
+        timer.stop();
+        timer.reset(true);
+    }
+    for (auto _ : state) benchmark::DoNotOptimize(timer.toString());
+}
+
+void historyArguments(benchmark::internal::Benchmark *benchmark, std::initializer_list<long> runs) {
+    benchmark->ArgNames({"runs", "history"});
+    for (long count : runs) {
+        for (int history : {TimerBase::KeepAll, TimerBase::Streaming, TimerBase::Reservoir}) {
+            benchmark->Args({count, history});
+        }
+    }
+}
+}
+
+BENCHMARK_TEMPLATE(BM_ClockNow, hector_timeit::ChronoClock);
+BENCHMARK_TEMPLATE(BM_ClockNow, hector_timeit::TscClock);
+BENCHMARK_TEMPLATE(BM_EmptyTimeBlock, hector_timeit::ChronoClock);
+BENCHMARK_TEMPLATE(BM_EmptyTimeBlock, hector_timeit::TscClock);
+BENCHMARK_TEMPLATE(BM_EmptyTimeBlock, hector_timeit::CalibratedClock);
+BENCHMARK_TEMPLATE(BM_StartStop, hector_timeit::ChronoClock);
+BENCHMARK_TEMPLATE(BM_StartStop, hector_timeit::TscClock);
+BENCHMARK_TEMPLATE(BM_StartStop, hector_timeit::CalibratedClock);
+BENCHMARK(BM_EmptyConcurrentTimeBlock)->Threads(1)->Threads(4);
+BENCHMARK(BM_EmptyTimeBlockTraced);
+BENCHMARK(BM_EmptyTimeBlockPerfCounters);
+BENCHMARK(BM_EmptyTimeBlockAllocationTracking);
+BENCHMARK(BM_ResetNewRun)->Apply([](benchmark::internal::Benchmark *benchmark) {
+    historyArguments(benchmark, {0, 1000000});
+});
+BENCHMARK(BM_ToString)->Unit(benchmark::kMillisecond)->Apply([](benchmark::internal::Benchmark *benchmark) {
+    historyArguments(benchmark, {1000, 1000000});
+});
+
+BENCHMARK_MAIN();
@@ -0,0 +1,441 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+// Compares the ways of getting the overlay's pixels from the framebuffer they are painted into to the texture that is
+// composited into the scene. Both live on the same headless EGL context (see HeadlessGLContext): the source
+// framebuffer stands in for Qt's FBO and the target texture for Ogre's overlay texture.
+// Every frame changes a full-width band covering the given percentage of the rows which then has to be transferred.
+// At most two frames are in flight, like with a double buffered swap chain, so asynchronous strategies can overlap
+// frames but cannot queue work without bound.
+//
+// Arguments of each benchmark: width, height, dirty percentage. Run, e.g., with Mesa's llvmpipe:
+//
+//   LIBGL_ALWAYS_SOFTWARE=1 overlay_test_upload_benchmark --benchmark_filter=TexSubImage
+//
+// The rings read back asynchronously, hence, their output lags the painting by RING_SIZE - 1 frames.
+
+#include "headless_gl_context.hpp"
+
+#include <benchmark/benchmark.h>
+#include <EGL/egl.h>
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+constexpr int RING_SIZE = 3;
+constexpr int FRAMES_IN_FLIGHT = 2;
+
+struct GLFunctions {
+    PFNGLGENBUFFERSPROC genBuffers = nullptr;
+    PFNGLDELETEBUFFERSPROC deleteBuffers = nullptr;
+    PFNGLBINDBUFFERPROC bindBuffer = nullptr;
+    PFNGLBUFFERDATAPROC bufferData = nullptr;
+    PFNGLBUFFERSTORAGEPROC bufferStorage = nullptr;
+    PFNGLMAPBUFFERRANGEPROC mapBufferRange = nullptr;
+    PFNGLUNMAPBUFFERPROC unmapBuffer = nullptr;
+    PFNGLGENFRAMEBUFFERSPROC genFramebuffers = nullptr;
+    PFNGLDELETEFRAMEBUFFERSPROC deleteFramebuffers = nullptr;
+    PFNGLBINDFRAMEBUFFERPROC bindFramebuffer = nullptr;
+    PFNGLFRAMEBUFFERTEXTURE2DPROC framebufferTexture2D = nullptr;
+    PFNGLBLITFRAMEBUFFERPROC blitFramebuffer = nullptr;
+    PFNGLFENCESYNCPROC fenceSync = nullptr;
+    PFNGLCLIENTWAITSYNCPROC clientWaitSync = nullptr;
+    PFNGLDELETESYNCPROC deleteSync = nullptr;
+};
+
+template<typename T>
+void resolve(T &function, const char *name) {
+    function = reinterpret_cast<T>(eglGetProcAddress(name));
+}
+
+const GLFunctions &gl() {
+    static const GLFunctions result = [] {
+        GLFunctions functions;
+        resolve(functions.genBuffers, "glGenBuffers");
+        resolve(functions.deleteBuffers, "glDeleteBuffers");
+        resolve(functions.bindBuffer, "glBindBuffer");
+        resolve(functions.bufferData, "glBufferData");
+        resolve(functions.bufferStorage, "glBufferStorage");
+        resolve(functions.mapBufferRange, "glMapBufferRange");
+        resolve(functions.unmapBuffer, "glUnmapBuffer");
+        resolve(functions.genFramebuffers, "glGenFramebuffers");
+        resolve(functions.deleteFramebuffers, "glDeleteFramebuffers");
+        resolve(functions.bindFramebuffer, "glBindFramebuffer");
+        resolve(functions.framebufferTexture2D, "glFramebufferTexture2D");
+        resolve(functions.blitFramebuffer, "glBlitFramebuffer");
+        resolve(functions.fenceSync, "glFenceSync");
+        resolve(functions.clientWaitSync, "glClientWaitSync");
+        resolve(functions.deleteSync, "glDeleteSync");
+        return functions;
+    }();
+    return result;
+}
+
+bool hasExtension(const char *name) {
+    const char *extensions = reinterpret_cast<const char *>(glGetString(GL_EXTENSIONS));
+    return extensions != nullptr && std::strstr(extensions, name) != nullptr;
+}
+
+//! @return The context, current on the calling thread, or nullptr if it could not be created.
+HeadlessGLContext *context() {
+    static HeadlessGLContext context;
+    if (!context.isValid()) return nullptr;
+    context.makeCurrent();
+    return &context;
+}
+
+void waitSync(GLsync sync) {
+    if (sync == nullptr) return;
+    gl().clientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    gl().deleteSync(sync);
+}
+
+struct Rect {
+    int x, y, width, height;
+
+    size_t bytes() const { return 4ul * width * height; }
+};
+
+/*!
+ * The source framebuffer with its texture, the target texture and the frame pacing shared by all strategies.
+ */
+class Overlay {
+public:
+    Overlay(int width, int height, int dirty_percent) : width_(width), height_(height) {
+        dirty_rows_ = std::max(1, height * dirty_percent / 100);
+        source_texture_ = createTexture();
+        target_texture_ = createTexture();
+        source_fbo_ = createFramebuffer(source_texture_);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
+    ~Overlay() {
+        for (GLsync &sync : frame_syncs_) waitSync(sync);
+        gl().bindFramebuffer(GL_FRAMEBUFFER, 0);
+        gl().deleteFramebuffers(1, &source_fbo_);
+        glDeleteTextures(1, &source_texture_);
+        glDeleteTextures(1, &target_texture_);
+    }
+
+    int width() const { return width_; }
+
+    int height() const { return height_; }
+
+    GLuint sourceFramebuffer() const { return source_fbo_; }
+
+    GLuint targetTexture() const { return target_texture_; }
+
+    GLuint createFramebuffer(GLuint texture) const {
+        GLuint framebuffer = 0;
+        gl().genFramebuffers(1, &framebuffer);
+        gl().bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        gl().framebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+        return framebuffer;
+    }
+
+    /*!
+     * Paints the next frame into the source framebuffer which is left bound for reading.
+     * @return The changed region in framebuffer coordinates.
+     */
+    Rect paint() {
+        ++frame_;
+        const Rect dirty{0, static_cast<int>(frame_ * 13 % (height_ - dirty_rows_ + 1)), width_, dirty_rows_};
+        gl().bindFramebuffer(GL_FRAMEBUFFER, source_fbo_);
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(dirty.x, dirty.y, dirty.width, dirty.height);
+        glClearColor(static_cast<float>(frame_ % 7) / 7, static_cast<float>(frame_ % 11) / 11, 0.5f, 0.5f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glDisable(GL_SCISSOR_TEST);
+        return dirty;
+    }
+
+    //! Ends the frame. Waits until at most FRAMES_IN_FLIGHT frames are queued.
+    void endFrame() {
+        GLsync &sync = frame_syncs_[frame_ % FRAMES_IN_FLIGHT];
+        waitSync(sync);
+        sync = gl().fenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+private:
+    GLuint createTexture() const {
+        GLuint texture = 0;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        return texture;
+    }
+
+    int width_, height_;
+    int dirty_rows_;
+    uint64_t frame_ = 0;
+    GLuint source_fbo_ = 0;
+    GLuint source_texture_ = 0;
+    GLuint target_texture_ = 0;
+    std::array<GLsync, FRAMES_IN_FLIGHT> frame_syncs_{};
+};
+
+bool setUp(benchmark::State &state) {
+    if (context() == nullptr) {
+        state.SkipWithError("Failed to create a headless GL context.");
+        return false;
+    }
+    if (gl().genFramebuffers == nullptr || gl().fenceSync == nullptr || gl().mapBufferRange == nullptr) {
+        state.SkipWithError("Framebuffer objects, sync objects or buffer mapping are not supported.");
+        return false;
+    }
+    return true;
+}
+
+void finish(benchmark::State &state, size_t bytes_per_frame) {
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes_per_frame));
+    state.counters["frame_bytes"] = static_cast<double>(bytes_per_frame);
+}
+
+//! In place like QOpenGLWrapper::draw, without a temporary row.
+void flipRows(uint8_t *data, size_t row_size, int rows) {
+    for (int top = 0, bottom = rows - 1; top < bottom; ++top, --bottom) {
+        std::swap_ranges(data + top * row_size, data + (top + 1) * row_size, data + bottom * row_size);
+    }
+}
+
+/*!
+ * The original path: QOpenGLFramebufferObject::toImage() allocates an image, reads back the full framebuffer and
+ * converts it into a second, mirrored ARGB32 image which is uploaded with glTexImage2D.
+ */
+void BM_ToImageTexImage(benchmark::State &state) {
+    if (!setUp(state)) return;
+    Overlay overlay(state.range(0), state.range(1), state.range(2));
+    const size_t row_size = 4ul * overlay.width();
+    for (auto _ : state) {
+        overlay.paint();
+        std::vector<uint8_t> pixels(row_size * overlay.height());
+        glReadPixels(0, 0, overlay.width(), overlay.height(), GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        std::vector<uint8_t> image(pixels.size());
+        for (int y = 0; y < overlay.height(); ++y) {
+            const uint8_t *in = pixels.data() + (overlay.height() - 1 - y) * row_size;
+            uint8_t *out = image.data() + y * row_size;
+            for (int x = 0; x < overlay.width(); ++x, in += 4, out += 4) {
+                out[0] = in[2];
+                out[1] = in[1];
+                out[2] = in[0];
+                out[3] = in[3];
+            }
+        }
+        glBindTexture(GL_TEXTURE_2D, overlay.targetTexture());
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, overlay.width(), overlay.height(), 0, GL_BGRA, GL_UNSIGNED_BYTE,
+                     image.data());
+        overlay.endFrame();
+    }
+    finish(state, row_size * overlay.height());
+}
+
+//! Full readback into a reused buffer and glTexImage2D. Isolates the cost of the allocations and the conversion.
+void BM_ReadPixelsTexImage(benchmark::State &state) {
+    if (!setUp(state)) return;
+    Overlay overlay(state.range(0), state.range(1), state.range(2));
+    std::vector<uint8_t> pixels(4ul * overlay.width() * overlay.height());
+    for (auto _ : state) {
+        overlay.paint();
+        glReadPixels(0, 0, overlay.width(), overlay.height(), GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        glBindTexture(GL_TEXTURE_2D, overlay.targetTexture());
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, overlay.width(), overlay.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                     pixels.data());
+        overlay.endFrame();
+    }
+    finish(state, pixels.size());
+}
+
+//! The current QOpenGLWrapper path: readback of the dirty region into a reused buffer, row flip and glTexSubImage2D.
+void BM_ReadPixelsTexSubImage(benchmark::State &state) {
+    if (!setUp(state)) return;
+    Overlay overlay(state.range(0), state.range(1), state.range(2));
+    std::vector<uint8_t> pixels;
+    size_t bytes = 0;
+    for (auto _ : state) {
+        const Rect dirty = overlay.paint();
+        pixels.resize(dirty.bytes());
+        glReadPixels(dirty.x, dirty.y, dirty.width, dirty.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        flipRows(pixels.data(), 4ul * dirty.width, dirty.height);
+        glBindTexture(GL_TEXTURE_2D, overlay.targetTexture());
+        glTexSubImage2D(GL_TEXTURE_2D, 0, dirty.x, overlay.height() - dirty.y - dirty.height, dirty.width,
+                        dirty.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        overlay.endFrame();
+        bytes = dirty.bytes();
+    }
+    finish(state, bytes);
+}
+
+/*!
+ * Asynchronous readback of the dirty region into a ring of pixel pack buffers. The oldest buffer is mapped and
+ * uploaded from client memory, as the Ogre context cannot access the Qt context's buffers.
+ * Rows are not flipped, the painting would have to be flipped at the source, e.g., with
+ * QOpenGLPaintDevice::setPaintFlipped.
+ */
+void BM_PboRing(benchmark::State &state) {
+    if (!setUp(state)) return;
+    Overlay overlay(state.range(0), state.range(1), state.range(2));
+    const size_t capacity = 4ul * overlay.width() * overlay.height();
+    std::array<GLuint, RING_SIZE> buffers{};
+    std::array<Rect, RING_SIZE> rects{};
+    gl().genBuffers(RING_SIZE, buffers.data());
+    for (GLuint buffer : buffers) {
+        gl().bindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+        gl().bufferData(GL_PIXEL_PACK_BUFFER, capacity, nullptr, GL_STREAM_READ);
+    }
+    uint64_t frame = 0;
+    size_t bytes = 0;
+    for (auto _ : state) {
+        const size_t slot = frame % RING_SIZE;
+        rects[slot] = overlay.paint();
+        gl().bindBuffer(GL_PIXEL_PACK_BUFFER, buffers[slot]);
+        glReadPixels(rects[slot].x, rects[slot].y, rects[slot].width, rects[slot].height, GL_RGBA, GL_UNSIGNED_BYTE,
+                     nullptr);
+        ++frame;
+        if (frame >= RING_SIZE) {
+            const size_t oldest = frame % RING_SIZE;
+            const Rect &dirty = rects[oldest];
+            gl().bindBuffer(GL_PIXEL_PACK_BUFFER, buffers[oldest]);
+            void *pixels = gl().mapBufferRange(GL_PIXEL_PACK_BUFFER, 0, dirty.bytes(), GL_MAP_READ_BIT);
+            if (pixels == nullptr) {
+                gl().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+                state.SkipWithError("Failed to map the pack buffer.");
+                break;
+            }
+            glBindTexture(GL_TEXTURE_2D, overlay.targetTexture());
+            glTexSubImage2D(GL_TEXTURE_2D, 0, dirty.x, dirty.y, dirty.width, dirty.height, GL_RGBA, GL_UNSIGNED_BYTE,
+                            pixels);
+            gl().unmapBuffer(GL_PIXEL_PACK_BUFFER);
+            bytes = dirty.bytes();
+        }
+        gl().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        overlay.endFrame();
+    }
+    gl().deleteBuffers(RING_SIZE, buffers.data());
+    state.SetLabel("latency " + std::to_string(RING_SIZE - 1) + " frames");
+    finish(state, bytes);
+}
+
+/*!
+ * Like BM_PboRing but the pack buffers are mapped once (ARB_buffer_storage, persistent and coherent) and each slot is
+ * guarded by a fence instead of mapping and unmapping every frame.
+ */
+void BM_PersistentRing(benchmark::State &state) {
+    if (!setUp(state)) return;
+    if (gl().bufferStorage == nullptr || !hasExtension("GL_ARB_buffer_storage")) {
+        state.SkipWithError("ARB_buffer_storage is not supported.");
+        return;
+    }
+    Overlay overlay(state.range(0), state.range(1), state.range(2));
+    const size_t capacity = 4ul * overlay.width() * overlay.height();
+    const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    std::array<GLuint, RING_SIZE> buffers{};
+    std::array<const uint8_t *, RING_SIZE> mapped{};
+    std::array<GLsync, RING_SIZE> syncs{};
+    std::array<Rect, RING_SIZE> rects{};
+    gl().genBuffers(RING_SIZE, buffers.data());
+    for (int i = 0; i < RING_SIZE; ++i) {
+        gl().bindBuffer(GL_PIXEL_PACK_BUFFER, buffers[i]);
+        gl().bufferStorage(GL_PIXEL_PACK_BUFFER, capacity, nullptr, flags);
+        mapped[i] = static_cast<const uint8_t *>(gl().mapBufferRange(GL_PIXEL_PACK_BUFFER, 0, capacity, flags));
+    }
+    if (std::find(mapped.begin(), mapped.end(), nullptr) != mapped.end()) {
+        for (int i = 0; i < RING_SIZE; ++i) {
+            if (mapped[i] == nullptr) continue;
+            gl().bindBuffer(GL_PIXEL_PACK_BUFFER, buffers[i]);
+            gl().unmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        gl().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        gl().deleteBuffers(RING_SIZE, buffers.data());
+        state.SkipWithError("Failed to map the persistent pack buffers.");
+        return;
+    }
+    uint64_t frame = 0;
+    size_t bytes = 0;
+    for (auto _ : state) {
+        const size_t slot = frame % RING_SIZE;
+        rects[slot] = overlay.paint();
+        gl().bindBuffer(GL_PIXEL_PACK_BUFFER, buffers[slot]);
+        glReadPixels(rects[slot].x, rects[slot].y, rects[slot].width, rects[slot].height, GL_RGBA, GL_UNSIGNED_BYTE,
+                     nullptr);
+        gl().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        syncs[slot] = gl().fenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        ++frame;
+        if (frame >= RING_SIZE) {
+            const size_t oldest = frame % RING_SIZE;
+            const Rect &dirty = rects[oldest];
+            waitSync(syncs[oldest]);
+            syncs[oldest] = nullptr;
+            glBindTexture(GL_TEXTURE_2D, overlay.targetTexture());
+            glTexSubImage2D(GL_TEXTURE_2D, 0, dirty.x, dirty.y, dirty.width, dirty.height, GL_RGBA, GL_UNSIGNED_BYTE,
+                            mapped[oldest]);
+            bytes = dirty.bytes();
+        }
+        overlay.endFrame();
+    }
+    for (int i = 0; i < RING_SIZE; ++i) {
+        waitSync(syncs[i]);
+        gl().bindBuffer(GL_PIXEL_PACK_BUFFER, buffers[i]);
+        gl().unmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    gl().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    gl().deleteBuffers(RING_SIZE, buffers.data());
+    state.SetLabel("latency " + std::to_string(RING_SIZE - 1) + " frames");
+    finish(state, bytes);
+}
+
+/*!
+ * No transfer through client memory: the dirty region is blitted into the target texture on the GPU, flipped by the
+ * blit. Stands in for painting directly into the texture, which requires the Qt and Ogre contexts to be shared.
+ */
+void BM_DirectFbo(benchmark::State &state) {
+    if (!setUp(state)) return;
+    if (gl().blitFramebuffer == nullptr) {
+        state.SkipWithError("glBlitFramebuffer is not supported.");
+        return;
+    }
+    Overlay overlay(state.range(0), state.range(1), state.range(2));
+    const GLuint target_fbo = overlay.createFramebuffer(overlay.targetTexture());
+    size_t bytes = 0;
+    for (auto _ : state) {
+        const Rect dirty = overlay.paint();
+        gl().bindFramebuffer(GL_READ_FRAMEBUFFER, overlay.sourceFramebuffer());
+        gl().bindFramebuffer(GL_DRAW_FRAMEBUFFER, target_fbo);
+        const int target_y = overlay.height() - dirty.y;
+        gl().blitFramebuffer(dirty.x, dirty.y, dirty.x + dirty.width, dirty.y + dirty.height, dirty.x, target_y,
+                             dirty.x + dirty.width, target_y - dirty.height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        overlay.endFrame();
+        bytes = dirty.bytes();
+    }
+    gl().bindFramebuffer(GL_FRAMEBUFFER, 0);
+    gl().deleteFramebuffers(1, &target_fbo);
+    finish(state, bytes);
+}
+
+//! Resolutions times dirty percentages.
+void uploadArguments(benchmark::internal::Benchmark *benchmark) {
+    benchmark->ArgNames({"width", "height", "dirty_%"});
+    for (const auto &size : std::vector<std::array<int, 2>>{{640, 480}, {1920, 1080}, {3840, 2160}}) {
+        for (int dirty_percent : {1, 10, 50, 100}) benchmark->Args({size[0], size[1], dirty_percent});
+    }
+    benchmark->Unit(benchmark::kMicrosecond)->UseRealTime();
+}
+}
+
+BENCHMARK(BM_ToImageTexImage)->Apply(uploadArguments);
+BENCHMARK(BM_ReadPixelsTexImage)->Apply(uploadArguments);
+BENCHMARK(BM_ReadPixelsTexSubImage)->Apply(uploadArguments);
+BENCHMARK(BM_PboRing)->Apply(uploadArguments);
+BENCHMARK(BM_PersistentRing)->Apply(uploadArguments);
+BENCHMARK(BM_DirectFbo)->Apply(uploadArguments);
+
+BENCHMARK_MAIN();
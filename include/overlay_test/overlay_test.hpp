@@ -3,6 +3,26 @@
 
 #include "overlay_test/visibility_control.h"
 #include <rviz_common/display.hpp>
+#include <rclcpp/service.hpp>
+#include <rclcpp/subscription_base.hpp>
+#include <rclcpp/timer.hpp>
+
+#include <memory>
+#include <vector>
+
+class FramePacingAnalyzer;
+struct OgreOverlay;
+class PerformanceHudLayer;
+class TimerStatsPublisher;
+
+namespace rviz_common
+{
+namespace properties
+{
+class BoolProperty;
+class FloatProperty;
+}
+}
 
 namespace overlay_test
 {
@@ -15,6 +35,22 @@ public:
   virtual ~OverlayTestDisplay();
 
   void onInitialize() override;
+
+  void update(float wall_dt, float ros_dt) override;
+
+private:
+  std::vector<rclcpp::SubscriptionBase::SharedPtr> subscriptions_;
+  rclcpp::ServiceBase::SharedPtr dump_trace_service_;
+  rviz_common::properties::FloatProperty *stats_rate_property_;
+  rviz_common::properties::FloatProperty *gpu_memory_budget_property_;
+  std::unique_ptr<TimerStatsPublisher> stats_publisher_;
+  rviz_common::properties::BoolProperty *performance_hud_property_;
+  std::shared_ptr<PerformanceHudLayer> performance_hud_layer_;
+  //! Samples the statistics shown by the HUD on the executor instead of the render thread.
+  rclcpp::TimerBase::SharedPtr performance_hud_timer_;
+  std::unique_ptr<OgreOverlay> ogre_overlay_;
+  //! Owned by the overlay's QOpenGLWrapper.
+  FramePacingAnalyzer *frame_pacing_ = nullptr;
 };
 
 }  // namespace overlay_test
@@ -0,0 +1,158 @@
+#ifndef OVERLAY_TEST__SHARED_FRAME_HPP_
+#define OVERLAY_TEST__SHARED_FRAME_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Protocol for out-of-process overlay producers.
+ *
+ * A producer creates a POSIX shared memory object containing a SharedFrameHeader followed by slot_count RGBA8
+ * frames (rows top first, tightly packed) starting at sharedFramePixelOffset(). Frame n is written to slot
+ * n % slot_count. Each slot is guarded by a sequence lock: its state is 2 * n + 1 while frame n is written and
+ * 2 * n + 2 once it is complete. After completing a frame, latest is set to n + 1.
+ * Every slot has to contain the complete frame, the dirty rectangle only tells the consumer which part changed
+ * compared to the previous frame.
+ */
+namespace overlay_test
+{
+
+constexpr uint32_t SHARED_FRAME_MAGIC = 0x4652564f;  // "OVRF"
+constexpr uint32_t SHARED_FRAME_VERSION = 1;
+constexpr uint32_t SHARED_FRAME_MAX_SLOTS = 8;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared frame protocol requires lock-free atomics.");
+
+struct SharedFrameSlot
+{
+  std::atomic<uint64_t> state;
+  int32_t dirty_x;
+  int32_t dirty_y;
+  int32_t dirty_width;
+  int32_t dirty_height;
+};
+
+struct SharedFrameHeader
+{
+  //! Written last when the header is initialized.
+  std::atomic<uint32_t> magic;
+  uint32_t version;
+  uint32_t width;
+  uint32_t height;
+  uint32_t slot_count;
+  uint32_t reserved;
+  //! Number of the newest complete frame + 1, 0 if no frame was completed yet.
+  std::atomic<uint64_t> latest;
+  SharedFrameSlot slots[SHARED_FRAME_MAX_SLOTS];
+};
+
+inline size_t sharedFramePixelOffset()
+{
+  return (sizeof(SharedFrameHeader) + 63) & ~size_t(63);
+}
+
+inline size_t sharedFrameBytes(uint32_t width, uint32_t height)
+{
+  return size_t(width) * height * 4;
+}
+
+inline size_t sharedFrameSize(uint32_t width, uint32_t height, uint32_t slot_count)
+{
+  return sharedFramePixelOffset() + slot_count * sharedFrameBytes(width, height);
+}
+
+/*!
+ * Producer side of the protocol.
+ * Usage: write the complete frame to the pointer returned by beginFrame(), then call endFrame().
+ * An existing object of the same name, e.g., of a previous producer, is unlinked and a new object is created instead
+ * of resizing it. Consumers that still map the old object keep reading it until they notice that it was unlinked.
+ */
+class SharedFrameWriter
+{
+public:
+  SharedFrameWriter(std::string name, uint32_t width, uint32_t height, uint32_t slot_count = 3)
+  : name_(std::move(name))
+  {
+    if (slot_count < 2 || slot_count > SHARED_FRAME_MAX_SLOTS) {return;}
+    size_ = sharedFrameSize(width, height, slot_count);
+    shm_unlink(name_.c_str());
+    int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd == -1) {return;}
+    if (ftruncate(fd, size_) == -1) {
+      close(fd);
+      shm_unlink(name_.c_str());
+      return;
+    }
+    void * memory = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+      shm_unlink(name_.c_str());
+      return;
+    }
+    header_ = static_cast<SharedFrameHeader *>(memory);
+    header_->magic.store(0, std::memory_order_relaxed);
+    header_->version = SHARED_FRAME_VERSION;
+    header_->width = width;
+    header_->height = height;
+    header_->slot_count = slot_count;
+    header_->latest.store(0, std::memory_order_relaxed);
+    for (auto & slot : header_->slots) {
+      slot.state.store(0, std::memory_order_relaxed);
+    }
+    header_->magic.store(SHARED_FRAME_MAGIC, std::memory_order_release);
+  }
+
+  ~SharedFrameWriter()
+  {
+    if (header_ == nullptr) {return;}
+    munmap(header_, size_);
+    shm_unlink(name_.c_str());
+  }
+
+  SharedFrameWriter(const SharedFrameWriter &) = delete;
+  SharedFrameWriter & operator=(const SharedFrameWriter &) = delete;
+
+  bool isOpen() const {return header_ != nullptr;}
+
+  uint8_t * beginFrame()
+  {
+    SharedFrameSlot & slot = header_->slots[sequence_ % header_->slot_count];
+    slot.state.store(2 * sequence_ + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    return reinterpret_cast<uint8_t *>(header_) + sharedFramePixelOffset() +
+           (sequence_ % header_->slot_count) * sharedFrameBytes(header_->width, header_->height);
+  }
+
+  void endFrame(int32_t dirty_x, int32_t dirty_y, int32_t dirty_width, int32_t dirty_height)
+  {
+    SharedFrameSlot & slot = header_->slots[sequence_ % header_->slot_count];
+    slot.dirty_x = dirty_x;
+    slot.dirty_y = dirty_y;
+    slot.dirty_width = dirty_width;
+    slot.dirty_height = dirty_height;
+    slot.state.store(2 * sequence_ + 2, std::memory_order_release);
+    header_->latest.store(++sequence_, std::memory_order_release);
+  }
+
+  void endFrame()
+  {
+    endFrame(0, 0, header_->width, header_->height);
+  }
+
+private:
+  std::string name_;
+  SharedFrameHeader * header_ = nullptr;
+  size_t size_ = 0;
+  uint64_t sequence_ = 0;
+};
+
+}  // namespace overlay_test
+
+#endif  // OVERLAY_TEST__SHARED_FRAME_HPP_
@@ -0,0 +1,85 @@
+// Copyright (c) 2023 Stefan Fabian. All rights reserved.
+// Licensed under the MIT license.
+
+// Replaces the C allocator to count the allocations of each thread, see AllocationTracker.
+// The counting forwards to glibc's internal allocation functions, hence, this only works with glibc.
+
+#include "allocation_tracker.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <malloc.h>
+
+extern "C" {
+void *__libc_malloc( size_t size );
+void *__libc_calloc( size_t count, size_t size );
+void *__libc_realloc( void *ptr, size_t size );
+void *__libc_memalign( size_t alignment, size_t size );
+void __libc_free( void *ptr );
+}
+
+namespace
+{
+// Initial-exec TLS does not allocate on first access, which would recurse into malloc
+__attribute__( ( tls_model( "initial-exec" ) ) ) thread_local hector_timeit::AllocationCounts thread_counts;
+
+inline void *countAllocation( void *ptr )
+{
+  if ( ptr == nullptr )
+    return ptr;
+  ++thread_counts.allocations;
+  thread_counts.allocated_bytes += malloc_usable_size( ptr );
+  return ptr;
+}
+
+inline void countDeallocation( void *ptr )
+{
+  if ( ptr == nullptr )
+    return;
+  ++thread_counts.deallocations;
+  thread_counts.freed_bytes += malloc_usable_size( ptr );
+}
+} // namespace
+
+const hector_timeit::AllocationCounts *hector_timeit::detail::threadAllocationCounts() { return &thread_counts; }
+
+extern "C" {
+void *malloc( size_t size ) { return countAllocation( __libc_malloc( size ) ); }
+
+void *calloc( size_t count, size_t size ) { return countAllocation( __libc_calloc( count, size ) ); }
+
+void *realloc( void *ptr, size_t size )
+{
+  const size_t old_size = ptr == nullptr ? 0 : malloc_usable_size( ptr );
+  void *result = __libc_realloc( ptr, size );
+  // On failure, the old block is left untouched
+  if ( result == nullptr && size != 0 )
+    return result;
+  if ( ptr != nullptr ) {
+    ++thread_counts.deallocations;
+    thread_counts.freed_bytes += old_size;
+  }
+  return countAllocation( result );
+}
+
+void *memalign( size_t alignment, size_t size ) { return countAllocation( __libc_memalign( alignment, size ) ); }
+
+void *aligned_alloc( size_t alignment, size_t size ) { return memalign( alignment, size ); }
+
+int posix_memalign( void **ptr, size_t alignment, size_t size )
+{
+  if ( alignment % sizeof( void * ) != 0 || ( alignment & ( alignment - 1 ) ) != 0 )
+    return EINVAL;
+  void *result = memalign( alignment, size );
+  if ( result == nullptr )
+    return ENOMEM;
+  *ptr = result;
+  return 0;
+}
+
+void free( void *ptr )
+{
+  countDeallocation( ptr );
+  __libc_free( ptr );
+}
+}
@@ -0,0 +1,82 @@
+// Copyright (c) 2023 Stefan Fabian. All rights reserved.
+// Licensed under the MIT license.
+
+#ifndef HECTOR_TIMEIT_ALLOCATION_TRACKER_HPP
+#define HECTOR_TIMEIT_ALLOCATION_TRACKER_HPP
+
+#include <cstdint>
+
+namespace hector_timeit
+{
+
+//! Heap allocations of a thread. Bytes are the usable sizes of the blocks as reported by malloc_usable_size.
+struct AllocationCounts {
+  uint64_t allocations = 0;
+  uint64_t deallocations = 0;
+  uint64_t allocated_bytes = 0;
+  uint64_t freed_bytes = 0;
+
+  AllocationCounts operator-( const AllocationCounts &other ) const
+  {
+    AllocationCounts result;
+    result.allocations = allocations - other.allocations;
+    result.deallocations = deallocations - other.deallocations;
+    result.allocated_bytes = allocated_bytes - other.allocated_bytes;
+    result.freed_bytes = freed_bytes - other.freed_bytes;
+    return result;
+  }
+};
+
+namespace detail
+{
+/*!
+ * Defined by the hector_timeit_allocation_hooks library which replaces malloc, free and their variants, and with them
+ * the default global operator new and delete. Weak, so everything else works if the hooks are neither linked nor
+ * preloaded.
+ */
+const AllocationCounts *threadAllocationCounts() __attribute__( ( weak ) );
+} // namespace detail
+
+/*!
+ * Per-thread heap allocation counters.
+ * The counting requires the hector_timeit_allocation_hooks library to be linked into the executable or, e.g., for
+ * a plugin, to be loaded using LD_PRELOAD. Only allocations through the C allocator are seen, this includes the
+ * default operator new but not, e.g., mmap or GPU memory.
+ */
+class AllocationTracker
+{
+public:
+  //! @return True if the allocation hooks are installed.
+  static bool isAvailable() { return detail::threadAllocationCounts != nullptr; }
+
+  //! @return The counters of the calling thread since its start or zero if the hooks are not installed.
+  static AllocationCounts current()
+  {
+    if ( detail::threadAllocationCounts == nullptr )
+      return {};
+    return *detail::threadAllocationCounts();
+  }
+};
+
+/*!
+ * Counts the allocations of the calling thread from construction until the call of counts(), e.g., to assert that a
+ * steady-state code path does not allocate:
+ * @code
+ * AllocationScope scope;
+ * wrapper.draw();
+ * assert( scope.counts().allocations == 0 );
+ * @endcode
+ */
+class AllocationScope
+{
+public:
+  AllocationScope() : start_( AllocationTracker::current() ) { }
+
+  AllocationCounts counts() const { return AllocationTracker::current() - start_; }
+
+private:
+  AllocationCounts start_;
+};
+} // namespace hector_timeit
+
+#endif // HECTOR_TIMEIT_ALLOCATION_TRACKER_HPP
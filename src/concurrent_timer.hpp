@@ -0,0 +1,378 @@
+// Copyright (c) 2023 Stefan Fabian. All rights reserved.
+// Licensed under the MIT license.
+
+#ifndef HECTOR_TIMEIT_CONCURRENT_TIMER_HPP
+#define HECTOR_TIMEIT_CONCURRENT_TIMER_HPP
+
+#include "timer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+namespace hector_timeit
+{
+
+/*!
+ * Timer that can be used from multiple threads at the same time.
+ * Each thread records its runs into its own shard which is only written by that thread. Recording a run does not
+ * take a lock except for the very first run of a thread which registers its shard.
+ * When a thread exits, its shards are returned to their timers and reused by the next thread that registers, hence,
+ * a timer holds at most as many shards as threads used it at the same time. The statistics of a shard are kept when
+ * it is reused.
+ * Readers merge all shards on demand. Each shard is guarded by a sequence lock, so a reader retries instead of
+ * blocking the recording thread if it reads while a run is recorded.
+ *
+ * Runs are measured with ConcurrentTimeBlock. Unlike Timer there is no running state, hence, nothing to start or stop.
+ */
+class ConcurrentTimer
+{
+public:
+  /*!
+   * @param name The name of the timer. Used for printing in the toString method and stream operator.
+   * @param print_time_unit The time unit used for printing. If Default the time unit is automatically chosen.
+   * @param print_on_destruct If true, prints when the timer is destructed.
+   */
+  explicit ConcurrentTimer( std::string name, Timer::TimeUnit print_time_unit = Timer::Default,
+                            bool print_on_destruct = false );
+
+  ~ConcurrentTimer();
+
+  ConcurrentTimer( const ConcurrentTimer & ) = delete;
+  ConcurrentTimer &operator=( const ConcurrentTimer & ) = delete;
+
+  const std::string &name() const { return name_; }
+
+  //! The name interned by the TraceRecorder, which stays valid after the timer was destroyed.
+  const char *traceName() const { return trace_name_; }
+
+  //! Unique for the lifetime of the process, in contrast to the address of a timer.
+  size_t id() const { return id_; }
+
+  /*!
+   * Calls the callback with every ConcurrentTimer that currently exists.
+   * Timers are not destroyed while the callback runs. The callback must not create or destroy timers.
+   */
+  template<typename Callback>
+  static void forEach( Callback &&callback )
+  {
+    Registry &registry = ConcurrentTimer::registry();
+    std::lock_guard<std::mutex> lock( registry.mutex );
+    for ( const ConcurrentTimer *timer : registry.timers ) callback( *timer );
+  }
+
+  /*!
+   * Records a finished run of the calling thread.
+   * @param time The wall time of the run in nanoseconds.
+   * @param cpu_time The thread or cpu time of the run in nanoseconds or -1 if not available.
+   */
+  inline void record( long time, long cpu_time )
+  {
+    Shard &shard = localShard();
+    uint64_t sequence = shard.sequence.load( std::memory_order_relaxed );
+    shard.sequence.store( sequence + 1, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+    shard.run.add( time );
+    shard.cpu.add( cpu_time );
+    shard.sequence.store( sequence + 2, std::memory_order_release );
+  }
+
+  /*!
+   * Merges the statistics of all threads.
+   */
+  void getStatistics( RunStatistics &run_stats, RunStatistics &cpu_run_stats ) const;
+
+  RunStatistics getRunStatistics() const;
+
+  RunStatistics getCpuRunStatistics() const;
+
+  std::string toString() const;
+
+private:
+  //! RunStatistics::add with atomic fields. Only the owning thread writes, hence, no read-modify-write is needed.
+  struct AtomicStatistics {
+    template<typename T>
+    static void set( std::atomic<T> &value, T new_value )
+    {
+      value.store( new_value, std::memory_order_relaxed );
+    }
+
+    template<typename T>
+    static T get( const std::atomic<T> &value )
+    {
+      return value.load( std::memory_order_relaxed );
+    }
+
+    void add( long time )
+    {
+      if ( time == -1 ) {
+        set( invalid_count, get( invalid_count ) + 1 );
+        return;
+      }
+      uint64_t n = get( count ) + 1;
+      set( count, n );
+      set( sum, get( sum ) + time );
+      if ( n == 1 || time < get( min ) )
+        set( min, time );
+      if ( time > get( max ) )
+        set( max, time );
+      double old_mean = get( mean );
+      double new_mean = old_mean + ( time - old_mean ) / n;
+      set( mean, new_mean );
+      set( m2, get( m2 ) + ( time - old_mean ) * ( time - new_mean ) );
+      std::atomic<uint64_t> &bucket = buckets[LogHistogram::bucketIndex( time )];
+      set( bucket, get( bucket ) + 1 );
+    }
+
+    RunStatistics load() const
+    {
+      LogHistogram histogram;
+      for ( int i = 0; i < LogHistogram::BucketCount; ++i ) {
+        uint64_t n = get( buckets[i] );
+        if ( n != 0 )
+          histogram.add( LogHistogram::bucketLowerBound( i ), n );
+      }
+      uint64_t n = get( count );
+      return RunStatistics::fromState( n, get( invalid_count ),
+                                       n == 0 ? std::numeric_limits<long>::max() : get( min ), get( max ),
+                                       get( sum ), get( mean ), get( m2 ), histogram );
+    }
+
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> invalid_count;
+    std::atomic<long> min;
+    std::atomic<long> max;
+    std::atomic<long long> sum;
+    std::atomic<double> mean;
+    std::atomic<double> m2;
+    std::array<std::atomic<uint64_t>, LogHistogram::BucketCount> buckets;
+  };
+
+  struct Shard {
+    //! Odd while the owning thread records a run.
+    std::atomic<uint64_t> sequence;
+    AtomicStatistics run;
+    AtomicStatistics cpu;
+  };
+
+  //! The shards of a thread indexed by the slot of their timer. Returns the shards to their timers on thread exit.
+  struct ThreadShards {
+    struct Entry {
+      //! The id of the timer, as slots are reused by timers created after a timer was destroyed.
+      size_t timer_id = 0;
+      Shard *shard = nullptr;
+    };
+
+    ~ThreadShards();
+
+    std::vector<Entry> entries;
+  };
+
+  inline Shard &localShard()
+  {
+    thread_local ThreadShards thread_shards;
+    if ( slot_ < thread_shards.entries.size() ) {
+      const ThreadShards::Entry &entry = thread_shards.entries[slot_];
+      if ( entry.shard != nullptr && entry.timer_id == id_ )
+        return *entry.shard;
+    }
+    return registerShard( thread_shards );
+  }
+
+  Shard &registerShard( ThreadShards &thread_shards );
+
+  //! Called with the registry locked when a thread that recorded into the shard exits.
+  void releaseShard( Shard *shard );
+
+  struct Registry {
+    std::mutex mutex;
+    std::vector<const ConcurrentTimer *> timers;
+    //! Timers by slot, nullptr if the slot is free. Slots are dense indices reused after a timer was destroyed.
+    std::vector<ConcurrentTimer *> slots;
+    std::vector<size_t> free_slots;
+  };
+
+  static Registry &registry()
+  {
+    static Registry registry;
+    return registry;
+  }
+
+  static size_t nextId()
+  {
+    static std::atomic<size_t> next_id{ 0 };
+    return next_id.fetch_add( 1, std::memory_order_relaxed );
+  }
+
+  const size_t id_;
+  size_t slot_ = 0;
+  std::string name_;
+  const char *trace_name_;
+  Timer::TimeUnit print_time_unit_;
+  bool print_on_destruct_;
+  mutable std::mutex shards_mutex_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  //! Shards of exited threads that are reused by the next thread that registers.
+  std::vector<Shard *> free_shards_;
+};
+
+/*!
+ * @brief Measures a single run on a ConcurrentTimer from construction until destruction or end().
+ * Uses a single clock read at the start and the end of the run. Recorded by the TraceRecorder like a TimeBlock.
+ */
+struct ConcurrentTimeBlock {
+  explicit ConcurrentTimeBlock( ConcurrentTimer &timer )
+      : timer_( timer ), traced_( TraceRecorder::isEnabled() ), cpu_time_valid_( Timer::getCpuTime( cpu_start_ ) ),
+        start_( std::chrono::high_resolution_clock::now() )
+  {
+    if ( traced_ )
+      TraceRecorder::begin( timer_.traceName() );
+  }
+
+  ~ConcurrentTimeBlock() { end(); }
+
+  void end()
+  {
+    if ( ended_ )
+      return;
+    ended_ = true;
+    auto end = std::chrono::high_resolution_clock::now();
+    long cpu_end = 0;
+    long cpu_time = cpu_time_valid_ && Timer::getCpuTime( cpu_end ) ? cpu_end - cpu_start_ : -1;
+    timer_.record( std::chrono::duration_cast<std::chrono::nanoseconds>( end - start_ ).count(), cpu_time );
+    if ( traced_ )
+      TraceRecorder::end( timer_.traceName() );
+  }
+
+  ConcurrentTimer &timer_;
+  bool traced_;
+  long cpu_start_ = 0;
+  bool cpu_time_valid_;
+  bool ended_ = false;
+  std::chrono::high_resolution_clock::time_point start_;
+};
+
+inline ConcurrentTimer::ConcurrentTimer( std::string name, Timer::TimeUnit print_time_unit,
+                                         bool print_on_destruct )
+    : id_( nextId() ), name_( std::move( name ) ), trace_name_( TraceRecorder::intern( name_ ) ),
+      print_time_unit_( print_time_unit ), print_on_destruct_( print_on_destruct )
+{
+  Registry &registry = ConcurrentTimer::registry();
+  std::lock_guard<std::mutex> lock( registry.mutex );
+  registry.timers.push_back( this );
+  if ( registry.free_slots.empty() ) {
+    slot_ = registry.slots.size();
+    registry.slots.push_back( this );
+  } else {
+    slot_ = registry.free_slots.back();
+    registry.free_slots.pop_back();
+    registry.slots[slot_] = this;
+  }
+}
+
+inline ConcurrentTimer::~ConcurrentTimer()
+{
+  {
+    Registry &registry = ConcurrentTimer::registry();
+    std::lock_guard<std::mutex> lock( registry.mutex );
+    registry.timers.erase( std::find( registry.timers.begin(), registry.timers.end(), this ) );
+    registry.slots[slot_] = nullptr;
+    registry.free_slots.push_back( slot_ );
+  }
+  if ( print_on_destruct_ )
+    std::cout << toString() << std::endl << std::flush;
+}
+
+inline ConcurrentTimer::Shard &ConcurrentTimer::registerShard( ThreadShards &thread_shards )
+{
+  Shard *result;
+  {
+    std::lock_guard<std::mutex> lock( shards_mutex_ );
+    if ( free_shards_.empty() ) {
+      // Value-initialized, hence, all atomics start at zero
+      shards_.push_back( std::unique_ptr<Shard>( new Shard() ) );
+      result = shards_.back().get();
+    } else {
+      // The mutex orders the writes of the exited thread before ours
+      result = free_shards_.back();
+      free_shards_.pop_back();
+    }
+  }
+  if ( thread_shards.entries.size() <= slot_ )
+    thread_shards.entries.resize( slot_ + 1 );
+  thread_shards.entries[slot_] = { id_, result };
+  return *result;
+}
+
+inline void ConcurrentTimer::releaseShard( Shard *shard )
+{
+  std::lock_guard<std::mutex> lock( shards_mutex_ );
+  free_shards_.push_back( shard );
+}
+
+inline ConcurrentTimer::ThreadShards::~ThreadShards()
+{
+  // Timers are removed from the registry under its lock when destroyed, hence, the timers found here stay alive
+  Registry &registry = ConcurrentTimer::registry();
+  std::lock_guard<std::mutex> lock( registry.mutex );
+  for ( size_t slot = 0; slot < entries.size(); ++slot ) {
+    const Entry &entry = entries[slot];
+    if ( entry.shard == nullptr || slot >= registry.slots.size() )
+      continue;
+    ConcurrentTimer *timer = registry.slots[slot];
+    if ( timer != nullptr && timer->id_ == entry.timer_id )
+      timer->releaseShard( entry.shard );
+  }
+}
+
+inline void ConcurrentTimer::getStatistics( RunStatistics &run_stats, RunStatistics &cpu_run_stats ) const
+{
+  run_stats.clear();
+  cpu_run_stats.clear();
+  std::lock_guard<std::mutex> lock( shards_mutex_ );
+  for ( const auto &shard : shards_ ) {
+    RunStatistics run, cpu;
+    while ( true ) {
+      uint64_t sequence = shard->sequence.load( std::memory_order_acquire );
+      if ( sequence % 2 == 1 )
+        continue;
+      run = shard->run.load();
+      cpu = shard->cpu.load();
+      std::atomic_thread_fence( std::memory_order_acquire );
+      if ( shard->sequence.load( std::memory_order_relaxed ) == sequence )
+        break;
+    }
+    run_stats.merge( run );
+    cpu_run_stats.merge( cpu );
+  }
+}
+
+inline RunStatistics ConcurrentTimer::getRunStatistics() const
+{
+  RunStatistics run_stats, cpu_run_stats;
+  getStatistics( run_stats, cpu_run_stats );
+  return run_stats;
+}
+
+inline RunStatistics ConcurrentTimer::getCpuRunStatistics() const
+{
+  RunStatistics run_stats, cpu_run_stats;
+  getStatistics( run_stats, cpu_run_stats );
+  return cpu_run_stats;
+}
+
+inline std::string ConcurrentTimer::toString() const
+{
+  RunStatistics run_stats, cpu_run_stats;
+  getStatistics( run_stats, cpu_run_stats );
+  return Timer::printStatistics( name_, run_stats, cpu_run_stats, print_time_unit_ );
+}
+
+} // namespace hector_timeit
+
+inline std::ostream &operator<<( std::ostream &stream, const hector_timeit::ConcurrentTimer &timer )
+{
+  return stream << timer.toString();
+}
+
+#endif // HECTOR_TIMEIT_CONCURRENT_TIMER_HPP
@@ -0,0 +1,107 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#include "console_layer.hpp"
+
+#include <QFontMetrics>
+#include <QPainter>
+
+#include <algorithm>
+
+namespace {
+QColor levelColor(uint8_t level) {
+    if (level >= ConsoleLayer::Error) return {255, 80, 80};
+    if (level >= ConsoleLayer::Warn) return {255, 200, 60};
+    if (level >= ConsoleLayer::Info) return {230, 230, 230};
+    return {150, 150, 150};
+}
+}
+
+ConsoleLayer::ConsoleLayer(const QRect &geometry, size_t capacity)
+        : OverlayLayer(geometry), lines_(std::max<size_t>(capacity, 1)), font_("Monospace") {
+    font_.setStyleHint(QFont::TypeWriter);
+    font_.setPointSize(9);
+    line_height_ = std::max(1, QFontMetrics(font_).height());
+}
+
+void ConsoleLayer::addLine(const std::string &logger, uint8_t level, std::string text) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Line &line = lines_[total_ % lines_.size()];
+        line.logger = internLogger(logger);
+        line.level = level;
+        line.text = std::move(text);
+        if (line.laid_out) {
+            line.layout = QStaticText();
+            line.laid_out = false;
+        }
+        ++total_;
+        // Keep the view where it is if the user scrolled back
+        if (scroll_offset_ > 0) ++scroll_offset_;
+    }
+    markContentArrived();
+    dirty_ = true;
+}
+
+void ConsoleLayer::scroll(int lines) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        scroll_offset_ = lines < 0 && size_t(-lines) > scroll_offset_ ? 0 : scroll_offset_ + lines;
+    }
+    dirty_ = true;
+}
+
+bool ConsoleLayer::isDirty() const {
+    return dirty_;
+}
+
+void ConsoleLayer::paint(QPainter &painter) {
+    dirty_ = false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    const uint64_t capacity = lines_.size();
+    const uint64_t rows = std::max(1, geometry().height() / line_height_);
+    const uint64_t oldest = total_ > capacity ? total_ - capacity : 0;
+    scroll_offset_ = std::min<uint64_t>(scroll_offset_, total_ - oldest);
+    const uint64_t end = total_ - scroll_offset_;
+    const uint64_t begin = end > oldest + rows ? end - rows : oldest;
+
+    // Release the layout of lines that scrolled out of view. Lines that were overwritten in the meantime were
+    // already released in addLine.
+    for (uint64_t i = std::max(visible_begin_, oldest); i < visible_end_; ++i) {
+        if (i >= begin && i < end) continue;
+        Line &line = lines_[i % capacity];
+        line.layout = QStaticText();
+        line.laid_out = false;
+    }
+    visible_begin_ = begin;
+    visible_end_ = end;
+
+    painter.fillRect(QRect(QPoint(0, 0), geometry().size()), QColor(0, 0, 0, 160));
+    painter.setFont(font_);
+    int y = geometry().height() - static_cast<int>(end - begin) * line_height_;
+    for (uint64_t i = begin; i < end; ++i, y += line_height_) {
+        Line &line = lines_[i % capacity];
+        if (!line.laid_out) layOut(line);
+        painter.setPen(levelColor(line.level));
+        painter.drawStaticText(4, y, line.layout);
+    }
+}
+
+uint32_t ConsoleLayer::internLogger(const std::string &name) {
+    auto it = logger_ids_.find(name);
+    if (it != logger_ids_.end()) return it->second;
+    uint32_t id = logger_names_.size();
+    logger_names_.push_back(QString::fromStdString(name));
+    logger_ids_.emplace(name, id);
+    return id;
+}
+
+void ConsoleLayer::layOut(Line &line) {
+    line.layout.setTextFormat(Qt::PlainText);
+    line.layout.setPerformanceHint(QStaticText::AggressiveCaching);
+    line.layout.setText(QLatin1Char('[') + logger_names_[line.logger] + QLatin1String("] ") +
+                        QString::fromStdString(line.text));
+    line.layout.prepare(QTransform(), font_);
+    line.laid_out = true;
+}
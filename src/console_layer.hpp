@@ -0,0 +1,80 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#ifndef CONSOLE_LAYER_HPP
+#define CONSOLE_LAYER_HPP
+
+#include "overlay_layer.hpp"
+
+#include <QFont>
+#include <QStaticText>
+#include <QString>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*!
+ * Scrolling log console, e.g., for /rosout.
+ * Lines are stored in a bounded ring and only the lines that are visible are laid out.
+ * The layout of a line is cached until it scrolls out of view or its slot in the ring is reused, hence, the cost
+ * of a frame only depends on the number of visible lines and not on the number of messages received.
+ */
+class ConsoleLayer : public OverlayLayer {
+public:
+    enum Level : uint8_t { Debug = 10, Info = 20, Warn = 30, Error = 40, Fatal = 50 };
+
+    /*!
+     * @param geometry The region of the overlay texture used by the console.
+     * @param capacity The maximum number of lines kept. Older lines are dropped.
+     */
+    explicit ConsoleLayer(const QRect &geometry, size_t capacity = 10000);
+
+    /*!
+     * Appends a line. Thread-safe and does not lay out any text.
+     */
+    void addLine(const std::string &logger, uint8_t level, std::string text);
+
+    /*!
+     * Scrolls the view by the given number of lines. Positive values scroll back into the history,
+     * an offset of 0 follows the newest line.
+     */
+    void scroll(int lines);
+
+    bool isDirty() const override;
+
+    void paint(QPainter &painter) override;
+
+private:
+    struct Line {
+        std::string text;
+        QStaticText layout;
+        uint32_t logger = 0;
+        uint8_t level = Info;
+        bool laid_out = false;
+    };
+
+    uint32_t internLogger(const std::string &name);
+
+    void layOut(Line &line);
+
+    mutable std::mutex mutex_;
+    std::vector<Line> lines_;
+    //! Total number of lines ever added. The newest line is at (total_ - 1) % capacity.
+    uint64_t total_ = 0;
+    //! Range [visible_begin_, visible_end_) of line numbers that were laid out in the last paint.
+    uint64_t visible_begin_ = 0;
+    uint64_t visible_end_ = 0;
+    size_t scroll_offset_ = 0;
+    std::unordered_map<std::string, uint32_t> logger_ids_;
+    std::vector<QString> logger_names_;
+    std::atomic<bool> dirty_{true};
+    QFont font_;
+    int line_height_;
+};
+
+#endif //CONSOLE_LAYER_HPP
@@ -0,0 +1,121 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#include "frame_pacing.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+namespace {
+long nanoseconds(FramePacingAnalyzer::Clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+std::ostream &milliseconds(std::ostream &stream, double nanoseconds) {
+    return stream << nanoseconds / 1e6 << " ms";
+}
+}
+
+FramePacingAnalyzer::FramePacingAnalyzer(size_t capacity, std::chrono::nanoseconds budget, size_t max_stalls)
+        : max_stalls_(max_stalls), budget_(budget.count()), frames_(std::max<size_t>(capacity, 2)),
+          latencies_(std::max<size_t>(capacity, 1)) {
+    pending_arrivals_.reserve(latencies_.size());
+}
+
+void FramePacingAnalyzer::setBudget(std::chrono::nanoseconds budget) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    budget_ = budget.count();
+}
+
+void FramePacingAnalyzer::recordFrame(Clock::time_point time) {
+    const long now = nanoseconds(time);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (frames_recorded_ > 0 && now - frames_[(frames_recorded_ - 1) % frames_.size()] > budget_) {
+        ++total_over_budget_;
+    }
+    frames_[frames_recorded_ % frames_.size()] = now;
+    ++frames_recorded_;
+    for (long arrival : pending_arrivals_) {
+        latencies_[latencies_recorded_ % latencies_.size()] = std::max(0L, now - arrival);
+        ++latencies_recorded_;
+    }
+    pending_arrivals_.clear();
+}
+
+void FramePacingAnalyzer::recordContentUpdate(Clock::time_point arrival) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Without frames, e.g., if the listener is not attached, drop the oldest instead of growing
+    if (pending_arrivals_.size() == pending_arrivals_.capacity()) pending_arrivals_.erase(pending_arrivals_.begin());
+    pending_arrivals_.push_back(nanoseconds(arrival));
+}
+
+FramePacingAnalyzer::Report FramePacingAnalyzer::report() const {
+    const long now = nanoseconds(Clock::now());
+    Report result;
+    std::vector<Stall> stalls;
+    std::lock_guard<std::mutex> lock(mutex_);
+    result.budget = budget_;
+    result.total_frames = frames_recorded_;
+    result.total_over_budget = total_over_budget_;
+    const uint64_t frame_count = std::min<uint64_t>(frames_recorded_, frames_.size());
+    long previous_interval = -1;
+    double variation = 0;
+    for (uint64_t i = frames_recorded_ - frame_count + 1; i < frames_recorded_; ++i) {
+        const long end = frames_[i % frames_.size()];
+        const long interval = end - frames_[(i - 1) % frames_.size()];
+        result.intervals.add(interval);
+        if (previous_interval >= 0) variation += std::labs(interval - previous_interval);
+        previous_interval = interval;
+        if (interval <= budget_) continue;
+        ++result.over_budget;
+        stalls.push_back({interval, now - end});
+    }
+    if (result.intervals.count() > 1) result.interval_variation = variation / (result.intervals.count() - 1);
+    const size_t stall_count = std::min(stalls.size(), max_stalls_);
+    std::partial_sort(stalls.begin(), stalls.begin() + stall_count, stalls.end(),
+                      [](const Stall &a, const Stall &b) { return a.duration > b.duration; });
+    stalls.resize(stall_count);
+    result.longest_stalls = std::move(stalls);
+
+    const uint64_t latency_count = std::min<uint64_t>(latencies_recorded_, latencies_.size());
+    for (uint64_t i = latencies_recorded_ - latency_count; i < latencies_recorded_; ++i) {
+        result.content_latency.add(latencies_[i % latencies_.size()]);
+    }
+    return result;
+}
+
+std::string FramePacingAnalyzer::Report::toString() const {
+    std::ostringstream stream;
+    stream.precision(3);
+    stream << "Frame pacing over the last " << intervals.count() << " frame interval(s), " << total_frames
+           << " frame(s) in total" << std::endl;
+    if (intervals.count() == 0) return stream.str();
+    stream << "  interval:  mean ";
+    milliseconds(stream, intervals.mean()) << ", p50 ";
+    milliseconds(stream, intervals.percentile(50)) << ", p99 ";
+    milliseconds(stream, intervals.percentile(99)) << ", max ";
+    milliseconds(stream, intervals.max()) << std::endl;
+    stream << "  jitter:    stddev ";
+    milliseconds(stream, jitter()) << ", frame to frame ";
+    milliseconds(stream, interval_variation) << std::endl;
+    stream << "  budget:    ";
+    milliseconds(stream, budget) << ", " << over_budget << " frame(s) over (" << total_over_budget << " in total)"
+                                 << std::endl;
+    if (!longest_stalls.empty()) {
+        stream << "  stalls:   ";
+        for (const Stall &stall : longest_stalls) {
+            stream << " ";
+            milliseconds(stream, stall.duration) << " (" << stall.age / 1e9 << " s ago)";
+        }
+        stream << std::endl;
+    }
+    if (content_latency.count() == 0) return stream.str();
+    stream << "  content latency over " << content_latency.count() << " update(s): mean ";
+    milliseconds(stream, content_latency.mean()) << ", p50 ";
+    milliseconds(stream, content_latency.percentile(50)) << ", p99 ";
+    milliseconds(stream, content_latency.percentile(99)) << ", max ";
+    milliseconds(stream, content_latency.max()) << std::endl;
+    return stream.str();
+}
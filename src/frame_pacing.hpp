@@ -0,0 +1,98 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#ifndef FRAME_PACING_HPP
+#define FRAME_PACING_HPP
+
+#include "timer.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*!
+ * Records when frames are rendered and when overlay content arrived in fixed-size rings to analyze the frame pacing,
+ * i.e., the stutter a mean frame time hides.
+ *
+ * A frame is recorded per postViewportUpdate of the render target. Content uploaded into the overlay texture in a
+ * postViewportUpdate is composited in the following frame, hence, the content latency of an update is the time from
+ * its arrival, e.g., the reception of the message, to the next recorded frame.
+ *
+ * Recording is thread-safe but is expected on the render thread. Reports may be created on any thread.
+ */
+class FramePacingAnalyzer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    //! A frame interval that was longer than the frame budget.
+    struct Stall {
+        //! Length of the interval in nanoseconds.
+        long duration = 0;
+        //! Time from the end of the interval to the creation of the report in nanoseconds.
+        long age = 0;
+    };
+
+    //! Statistics over the frames and content updates in the rings.
+    struct Report {
+        //! Intervals between consecutive frames in nanoseconds.
+        hector_timeit::RunStatistics intervals;
+        //! Mean absolute difference of consecutive intervals in nanoseconds. Unlike the standard deviation of the
+        //! intervals, it is not increased by a frame rate that changes slowly.
+        double interval_variation = 0;
+        //! The longest intervals over the budget, longest first.
+        std::vector<Stall> longest_stalls;
+        long budget = 0;
+        //! Intervals over the budget in the ring and since the construction.
+        uint64_t over_budget = 0;
+        uint64_t total_over_budget = 0;
+        uint64_t total_frames = 0;
+        //! Time from the arrival of content to the frame it is shown in in nanoseconds.
+        hector_timeit::RunStatistics content_latency;
+
+        //! Frame interval jitter, the standard deviation of the intervals in nanoseconds.
+        double jitter() const { return intervals.stddev(); }
+
+        std::string toString() const;
+    };
+
+    /*!
+     * @param capacity The number of frames and content updates kept, e.g., ~17 seconds at 60 Hz for 1024.
+     * @param budget The frame interval above which a frame counts as late, 60 Hz by default.
+     * @param max_stalls The number of longest stalls in a report.
+     */
+    explicit FramePacingAnalyzer(size_t capacity = 1024,
+                                 std::chrono::nanoseconds budget = std::chrono::nanoseconds(16666667),
+                                 size_t max_stalls = 5);
+
+    void setBudget(std::chrono::nanoseconds budget);
+
+    //! Records a frame, e.g., in postViewportUpdate.
+    void recordFrame(Clock::time_point time = Clock::now());
+
+    /*!
+     * Records content that arrived at the given time and was uploaded into the overlay texture after the last
+     * recorded frame. Its latency is taken at the next recorded frame.
+     */
+    void recordContentUpdate(Clock::time_point arrival);
+
+    Report report() const;
+
+private:
+    mutable std::mutex mutex_;
+    size_t max_stalls_;
+    long budget_;
+    //! Ring of frame timestamps in nanoseconds. The newest frame is at (frames_recorded_ - 1) % capacity.
+    std::vector<long> frames_;
+    uint64_t frames_recorded_ = 0;
+    uint64_t total_over_budget_ = 0;
+    //! Ring of content latencies in nanoseconds.
+    std::vector<long> latencies_;
+    uint64_t latencies_recorded_ = 0;
+    //! Arrivals of the content uploaded since the last frame. Bounded by the capacity.
+    std::vector<long> pending_arrivals_;
+};
+
+#endif //FRAME_PACING_HPP
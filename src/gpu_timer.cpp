@@ -0,0 +1,129 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#include "gpu_timer.hpp"
+#include "concurrent_timer.hpp"
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <GL/glx.h>
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+struct TimerQueryFunctions {
+    PFNGLGENQUERIESPROC genQueries = nullptr;
+    PFNGLDELETEQUERIESPROC deleteQueries = nullptr;
+    PFNGLQUERYCOUNTERPROC queryCounter = nullptr;
+    PFNGLGETQUERYOBJECTIVPROC getQueryObjectiv = nullptr;
+    PFNGLGETQUERYOBJECTUI64VPROC getQueryObjectui64v = nullptr;
+};
+
+template<typename T>
+void resolve(T &function, const char *name) {
+    function = reinterpret_cast<T>(glXGetProcAddressARB(reinterpret_cast<const GLubyte *>(name)));
+}
+
+//! Function pointers returned by GLX do not depend on the context, hence, they are resolved once.
+const TimerQueryFunctions &functions() {
+    static const TimerQueryFunctions result = [] {
+        TimerQueryFunctions functions;
+        resolve(functions.genQueries, "glGenQueries");
+        resolve(functions.deleteQueries, "glDeleteQueries");
+        resolve(functions.queryCounter, "glQueryCounter");
+        resolve(functions.getQueryObjectiv, "glGetQueryObjectiv");
+        resolve(functions.getQueryObjectui64v, "glGetQueryObjectui64v");
+        return functions;
+    }();
+    return result;
+}
+
+bool timerQueriesSupported() {
+    const char *version = reinterpret_cast<const char *>(glGetString(GL_VERSION));
+    int major = 0, minor = 0;
+    if (version != nullptr && std::sscanf(version, "%d.%d", &major, &minor) == 2 &&
+        (major > 3 || (major == 3 && minor >= 3)))
+        return true;
+    const char *extensions = reinterpret_cast<const char *>(glGetString(GL_EXTENSIONS));
+    return extensions != nullptr && std::strstr(extensions, "GL_ARB_timer_query") != nullptr;
+}
+}
+
+GpuTimer::GpuTimer(std::vector<hector_timeit::ConcurrentTimer *> stage_timers, size_t capacity)
+        : stage_timers_(std::move(stage_timers)), ring_(capacity) {
+}
+
+void GpuTimer::begin(size_t stage) {
+    if (!init()) return;
+    collect();
+    active_ = NONE;
+    if (pending_ == ring_.size()) return;
+    const size_t index = (oldest_ + pending_) % ring_.size();
+    ring_[index].stage = stage;
+    functions().queryCounter(ring_[index].start_query, GL_TIMESTAMP);
+    active_ = index;
+}
+
+void GpuTimer::end(size_t stage) {
+    if (active_ == NONE || ring_[active_].stage != stage) return;
+    functions().queryCounter(ring_[active_].end_query, GL_TIMESTAMP);
+    active_ = NONE;
+    ++pending_;
+}
+
+bool GpuTimer::init() {
+    if (state_ != Uninitialized) return state_ == Supported;
+    const TimerQueryFunctions &gl = functions();
+    if (!timerQueriesSupported() || gl.genQueries == nullptr || gl.queryCounter == nullptr ||
+        gl.getQueryObjectiv == nullptr || gl.getQueryObjectui64v == nullptr || gl.deleteQueries == nullptr ||
+        ring_.empty()) {
+        state_ = Unsupported;
+        return false;
+    }
+    // Query objects are released together with the context or by release
+    std::vector<GLuint> queries(2 * ring_.size());
+    gl.genQueries(static_cast<GLsizei>(queries.size()), queries.data());
+    for (size_t i = 0; i < ring_.size(); ++i) {
+        ring_[i].start_query = queries[2 * i];
+        ring_[i].end_query = queries[2 * i + 1];
+    }
+    state_ = Supported;
+    return true;
+}
+
+void GpuTimer::release() {
+    if (state_ != Supported) return;
+    std::vector<GLuint> queries;
+    queries.reserve(2 * ring_.size());
+    for (Measurement &measurement : ring_) {
+        queries.push_back(measurement.start_query);
+        queries.push_back(measurement.end_query);
+        measurement = Measurement();
+    }
+    functions().deleteQueries(static_cast<GLsizei>(queries.size()), queries.data());
+    // Recreated on the next use
+    state_ = Uninitialized;
+    oldest_ = 0;
+    pending_ = 0;
+    active_ = NONE;
+}
+
+void GpuTimer::collect() {
+    const TimerQueryFunctions &gl = functions();
+    while (pending_ > 0) {
+        const Measurement &measurement = ring_[oldest_];
+        // Queries complete in order, hence, the start is available if the end is
+        GLint available = 0;
+        gl.getQueryObjectiv(measurement.end_query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return;
+        GLuint64 start = 0, end = 0;
+        gl.getQueryObjectui64v(measurement.start_query, GL_QUERY_RESULT, &start);
+        gl.getQueryObjectui64v(measurement.end_query, GL_QUERY_RESULT, &end);
+        if (measurement.stage < stage_timers_.size() && end >= start)
+            stage_timers_[measurement.stage]->record(static_cast<long>(end - start), -1);
+        oldest_ = (oldest_ + 1) % ring_.size();
+        --pending_;
+    }
+}
@@ -0,0 +1,72 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#ifndef GPU_TIMER_HPP
+#define GPU_TIMER_HPP
+
+#include <cstddef>
+#include <vector>
+
+namespace hector_timeit {
+class ConcurrentTimer;
+}
+
+/*!
+ * Measures the GPU time of pipeline stages with GL_TIMESTAMP queries (ARB_timer_query).
+ * A measurement is only read back once its result is available, which is checked when the next stage begins, hence,
+ * measuring never stalls the pipeline. If all measurements in the ring are still pending, the stage is not measured.
+ * The measured times are recorded on the timer of the stage, the CPU time of these runs is reported as not available.
+ *
+ * Query objects belong to a GL context, hence, all calls have to be made with the same context current.
+ * Stages must not overlap. If timer queries are not supported, begin and end do nothing.
+ */
+class GpuTimer {
+public:
+    /*!
+     * @param stage_timers The timers that receive the GPU times of the stages indexed by the stage number.
+     * @param capacity The number of measurements that can be pending at the same time.
+     */
+    explicit GpuTimer(std::vector<hector_timeit::ConcurrentTimer *> stage_timers, size_t capacity = 32);
+
+    void begin(size_t stage);
+
+    void end(size_t stage);
+
+    /*!
+     * Deletes the queries, e.g., before the timer is destroyed while its context lives on. Pending measurements are
+     * dropped. Has to be called with the context of the queries current.
+     */
+    void release();
+
+private:
+    //! Creates the queries on first use. @return False if timer queries are not supported.
+    bool init();
+
+    //! Records all pending measurements in order until the first whose result is not available yet.
+    void collect();
+
+    struct Measurement {
+        unsigned int start_query = 0;
+        unsigned int end_query = 0;
+        size_t stage = 0;
+    };
+
+    enum State {
+        Uninitialized,
+        Supported,
+        Unsupported
+    };
+
+    static constexpr size_t NONE = static_cast<size_t>(-1);
+
+    std::vector<hector_timeit::ConcurrentTimer *> stage_timers_;
+    std::vector<Measurement> ring_;
+    State state_ = Uninitialized;
+    size_t oldest_ = 0;
+    size_t pending_ = 0;
+    //! Index of the measurement of the stage that was begun but not ended yet or NONE.
+    size_t active_ = NONE;
+};
+
+#endif //GPU_TIMER_HPP
@@ -0,0 +1,131 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#include "memory_account.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+namespace {
+struct Registry {
+    std::mutex mutex;
+    std::vector<const MemoryAccount *> accounts;
+};
+
+Registry &registry() {
+    static Registry registry;
+    return registry;
+}
+
+size_t nextId() {
+    static std::atomic<size_t> next_id{0};
+    return next_id++;
+}
+
+void updatePeak(std::atomic<size_t> &peak, size_t value) {
+    size_t current = peak.load(std::memory_order_relaxed);
+    while (value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+}
+
+//! Adds a difference of unsigned sizes, the atomic wraps around like the subtraction.
+size_t add(std::atomic<size_t> &value, size_t difference) {
+    return value.fetch_add(difference, std::memory_order_relaxed) + difference;
+}
+
+void appendRow(std::string &result, const char *name, const MemoryAccount::Usage &usage) {
+    char row[160];
+    std::snprintf(row, sizeof(row), "%-20s %10.1f %10.1f %10.1f %10.1f\n", name, usage.gpu_bytes / 1024.0,
+                  usage.peak_gpu_bytes / 1024.0, usage.cpu_bytes / 1024.0, usage.peak_cpu_bytes / 1024.0);
+    result += row;
+}
+}
+
+MemoryAccount::MemoryAccount(std::string name) : id_(nextId()), name_(std::move(name)) {
+    Registry &registry = ::registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.accounts.push_back(this);
+}
+
+MemoryAccount::~MemoryAccount() {
+    {
+        Registry &registry = ::registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.accounts.erase(std::find(registry.accounts.begin(), registry.accounts.end(), this));
+    }
+    for (int resource = 0; resource < ResourceCount; ++resource) set(static_cast<Resource>(resource), 0);
+}
+
+void MemoryAccount::set(Resource resource, size_t bytes) {
+    const size_t difference = bytes - bytes_[resource].exchange(bytes, std::memory_order_relaxed);
+    if (difference == 0) return;
+    Totals &totals = MemoryAccount::totals();
+    add(totals.bytes[resource], difference);
+    if (isGpu(resource)) {
+        updatePeak(peak_gpu_bytes_, add(gpu_bytes_, difference));
+        updatePeak(totals.peak_gpu_bytes, add(totals.gpu_bytes, difference));
+    } else {
+        updatePeak(peak_cpu_bytes_, add(cpu_bytes_, difference));
+        updatePeak(totals.peak_cpu_bytes, add(totals.cpu_bytes, difference));
+    }
+}
+
+MemoryAccount::Usage MemoryAccount::usage() const {
+    Usage result;
+    for (int resource = 0; resource < ResourceCount; ++resource) {
+        result.bytes[resource] = bytes_[resource].load(std::memory_order_relaxed);
+    }
+    result.gpu_bytes = gpu_bytes_.load(std::memory_order_relaxed);
+    result.cpu_bytes = cpu_bytes_.load(std::memory_order_relaxed);
+    result.peak_gpu_bytes = peak_gpu_bytes_.load(std::memory_order_relaxed);
+    result.peak_cpu_bytes = peak_cpu_bytes_.load(std::memory_order_relaxed);
+    return result;
+}
+
+const char *MemoryAccount::resourceName(Resource resource) {
+    switch (resource) {
+        case Texture: return "texture";
+        case Framebuffer: return "framebuffer";
+        case PixelBuffer: return "pixel_buffer";
+        case StagingBuffer: return "staging_buffer";
+        case Image: return "image";
+        case SharedMemory: return "shared_memory";
+        default: return "unknown";
+    }
+}
+
+void MemoryAccount::forEach(const std::function<void(const MemoryAccount &)> &callback) {
+    Registry &registry = ::registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (const MemoryAccount *account : registry.accounts) callback(*account);
+}
+
+MemoryAccount::Usage MemoryAccount::total() {
+    const Totals &totals = MemoryAccount::totals();
+    Usage result;
+    for (int resource = 0; resource < ResourceCount; ++resource) {
+        result.bytes[resource] = totals.bytes[resource].load(std::memory_order_relaxed);
+    }
+    result.gpu_bytes = totals.gpu_bytes.load(std::memory_order_relaxed);
+    result.cpu_bytes = totals.cpu_bytes.load(std::memory_order_relaxed);
+    result.peak_gpu_bytes = totals.peak_gpu_bytes.load(std::memory_order_relaxed);
+    result.peak_cpu_bytes = totals.peak_cpu_bytes.load(std::memory_order_relaxed);
+    return result;
+}
+
+std::string MemoryAccount::report() {
+    char header[160];
+    std::snprintf(header, sizeof(header), "%-20s %10s %10s %10s %10s\n", "Overlay memory (kB)", "GPU", "GPU peak",
+                  "CPU", "CPU peak");
+    std::string result = header;
+    forEach([&](const MemoryAccount &account) { appendRow(result, account.name().c_str(), account.usage()); });
+    appendRow(result, "total", total());
+    return result;
+}
+
+MemoryAccount::Totals &MemoryAccount::totals() {
+    static Totals totals;
+    return totals;
+}
@@ -0,0 +1,106 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#ifndef MEMORY_ACCOUNT_HPP
+#define MEMORY_ACCOUNT_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <string>
+
+/*!
+ * The GPU and CPU memory held by an owner of overlay resources, e.g., a layer or the QOpenGLWrapper, by kind of
+ * resource. Owners set the size of a resource whenever they (re)allocate it, the bytes are released when the
+ * account is destroyed.
+ *
+ * All accounts register in a process-wide registry, so the overlay's memory can be reported per owner and in total,
+ * e.g., to budget the GPU memory of several rviz instances on a shared machine. High-water marks are tracked per
+ * account and for the total when sizes are set. Sizes are computed from the dimensions and formats of the
+ * resources, driver overhead like alignment and mipmaps that were not requested is not included.
+ *
+ * Thread-safe.
+ */
+class MemoryAccount {
+public:
+    enum Resource {
+        //! GPU: textures, e.g., the overlay texture created with Ogre's TextureManager::createManual.
+        Texture,
+        //! GPU: framebuffer attachments, e.g., of the QOpenGLFramebufferObject painted into.
+        Framebuffer,
+        //! GPU: buffer objects, e.g., pixel buffers of an asynchronous readback.
+        PixelBuffer,
+        //! CPU: buffers pixels are transferred through, e.g., the readback buffer.
+        StagingBuffer,
+        //! CPU: images, pixel buffers and intermediate buffers of layers.
+        Image,
+        //! CPU: shared memory mapped from another process.
+        SharedMemory,
+        ResourceCount
+    };
+
+    struct Usage {
+        //! Current bytes by resource.
+        std::array<size_t, ResourceCount> bytes{};
+        size_t gpu_bytes = 0;
+        size_t cpu_bytes = 0;
+        //! The largest GPU and CPU bytes held at the same time.
+        size_t peak_gpu_bytes = 0;
+        size_t peak_cpu_bytes = 0;
+    };
+
+    explicit MemoryAccount(std::string name);
+
+    ~MemoryAccount();
+
+    MemoryAccount(const MemoryAccount &) = delete;
+
+    MemoryAccount &operator=(const MemoryAccount &) = delete;
+
+    //! Sets the bytes currently held of the given resource.
+    void set(Resource resource, size_t bytes);
+
+    Usage usage() const;
+
+    const std::string &name() const { return name_; }
+
+    //! Unique for the lifetime of the process.
+    size_t id() const { return id_; }
+
+    static bool isGpu(Resource resource) { return resource <= PixelBuffer; }
+
+    static const char *resourceName(Resource resource);
+
+    //! Calls the callback with every existing account while holding the registry's lock.
+    static void forEach(const std::function<void(const MemoryAccount &)> &callback);
+
+    //! The bytes of all accounts. The high-water marks include accounts that were destroyed.
+    static Usage total();
+
+    //! A table of the usage of all accounts and the total.
+    static std::string report();
+
+private:
+    //! Bytes of all accounts, updated by set.
+    struct Totals {
+        std::array<std::atomic<size_t>, ResourceCount> bytes{};
+        std::atomic<size_t> gpu_bytes{0};
+        std::atomic<size_t> cpu_bytes{0};
+        std::atomic<size_t> peak_gpu_bytes{0};
+        std::atomic<size_t> peak_cpu_bytes{0};
+    };
+
+    static Totals &totals();
+
+    const size_t id_;
+    const std::string name_;
+    std::array<std::atomic<size_t>, ResourceCount> bytes_{};
+    std::atomic<size_t> gpu_bytes_{0};
+    std::atomic<size_t> cpu_bytes_{0};
+    std::atomic<size_t> peak_gpu_bytes_{0};
+    std::atomic<size_t> peak_cpu_bytes_{0};
+};
+
+#endif //MEMORY_ACCOUNT_HPP
@@ -0,0 +1,108 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#include "minimap_kernels.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace minimap_kernels {
+
+namespace {
+constexpr uint8_t UNKNOWN_GRAY = 128;
+constexpr uint8_t UNKNOWN_ALPHA = 96;
+constexpr uint8_t KNOWN_ALPHA = 220;
+
+inline void colorizeScalar(int8_t value, uint8_t *rgba) {
+    uint8_t gray = UNKNOWN_GRAY, alpha = UNKNOWN_ALPHA;
+    if (value >= 0) {
+        // 653 / 256 ~ 2.55 maps 0..100 to 0..255 with the same rounding as the vectorized version
+        gray = 255 - ((std::min<int>(value, 100) * 653) >> 8);
+        alpha = KNOWN_ALPHA;
+    }
+    rgba[0] = rgba[1] = rgba[2] = gray;
+    rgba[3] = alpha;
+}
+}
+
+namespace scalar {
+void maxRows(const int8_t *src, size_t stride, int rows, int width, int8_t *out) {
+    std::memcpy(out, src, width);
+    for (int r = 1; r < rows; ++r) {
+        const int8_t *row = src + r * stride;
+        for (int i = 0; i < width; ++i) out[i] = std::max(out[i], row[i]);
+    }
+}
+
+void colorize(const int8_t *src, int count, uint8_t *rgba) {
+    for (int i = 0; i < count; ++i) colorizeScalar(src[i], rgba + 4 * i);
+}
+}  // namespace scalar
+
+void maxRows(const int8_t *src, size_t stride, int rows, int width, int8_t *out) {
+    int x = 0;
+#ifdef __SSE2__
+    // SSE2 has no signed byte max. Flipping the sign bit maps the signed order to the unsigned order.
+    const __m128i bias = _mm_set1_epi8(static_cast<char>(0x80));
+    for (; x + 16 <= width; x += 16) {
+        __m128i acc = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x)), bias);
+        for (int r = 1; r < rows; ++r) {
+            __m128i row = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + r * stride + x));
+            acc = _mm_max_epu8(acc, _mm_xor_si128(row, bias));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), _mm_xor_si128(acc, bias));
+    }
+#endif
+    scalar::maxRows(src + x, stride, rows, width - x, out + x);
+}
+
+void maxGroups(const int8_t *src, int width, int factor, int8_t *out) {
+    if (factor == 1) {
+        std::memcpy(out, src, width);
+        return;
+    }
+    for (int x = 0; x < width; x += factor) {
+        *out++ = *std::max_element(src + x, src + std::min(x + factor, width));
+    }
+}
+
+void colorize(const int8_t *src, int count, uint8_t *rgba) {
+    int i = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max_value = _mm_set1_epi8(100);
+    const __m128i scale = _mm_set1_epi16(653);
+    const __m128i unknown_gray = _mm_set1_epi8(static_cast<char>(UNKNOWN_GRAY));
+    const __m128i unknown_alpha = _mm_set1_epi8(static_cast<char>(UNKNOWN_ALPHA));
+    const __m128i known_alpha = _mm_set1_epi8(static_cast<char>(KNOWN_ALPHA));
+    for (; i + 16 <= count; i += 16) {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128i unknown = _mm_cmplt_epi8(value, zero);
+        value = _mm_min_epu8(_mm_andnot_si128(unknown, value), max_value);
+        __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(value, zero), scale), 8);
+        __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(value, zero), scale), 8);
+        // 255 - x == ~x for bytes
+        __m128i gray = _mm_xor_si128(_mm_packus_epi16(lo, hi), _mm_set1_epi8(-1));
+        gray = _mm_or_si128(_mm_and_si128(unknown, unknown_gray), _mm_andnot_si128(unknown, gray));
+        __m128i alpha = _mm_or_si128(_mm_and_si128(unknown, unknown_alpha), _mm_andnot_si128(unknown, known_alpha));
+
+        __m128i gg_lo = _mm_unpacklo_epi8(gray, gray);
+        __m128i gg_hi = _mm_unpackhi_epi8(gray, gray);
+        __m128i ga_lo = _mm_unpacklo_epi8(gray, alpha);
+        __m128i ga_hi = _mm_unpackhi_epi8(gray, alpha);
+        auto *dst = reinterpret_cast<__m128i *>(rgba + 4 * i);
+        _mm_storeu_si128(dst + 0, _mm_unpacklo_epi16(gg_lo, ga_lo));
+        _mm_storeu_si128(dst + 1, _mm_unpackhi_epi16(gg_lo, ga_lo));
+        _mm_storeu_si128(dst + 2, _mm_unpacklo_epi16(gg_hi, ga_hi));
+        _mm_storeu_si128(dst + 3, _mm_unpackhi_epi16(gg_hi, ga_hi));
+    }
+#endif
+    scalar::colorize(src + i, count - i, rgba + 4 * i);
+}
+
+}  // namespace minimap_kernels
@@ -0,0 +1,50 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#ifndef MINIMAP_KERNELS_HPP
+#define MINIMAP_KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/*!
+ * Kernels used to downsample and colour an occupancy grid. Occupancy values follow nav_msgs/OccupancyGrid,
+ * i.e., -1 is unknown and 0 to 100 is the occupancy probability. Downsampling keeps the maximum of a block
+ * which means occupied wins over free and free wins over unknown.
+ */
+namespace minimap_kernels {
+
+/*!
+ * Computes the element-wise maximum of rows consecutive rows.
+ * @param src Pointer to the first element of the first row.
+ * @param stride Distance between two rows in elements.
+ * @param out Output of size width.
+ */
+void maxRows(const int8_t *src, size_t stride, int rows, int width, int8_t *out);
+
+/*!
+ * Reduces each group of factor consecutive values to its maximum. The last group may be shorter.
+ * @param out Output of size ceil(width / factor).
+ */
+void maxGroups(const int8_t *src, int width, int factor, int8_t *out);
+
+/*!
+ * Maps occupancy values to RGBA pixels (byte order R, G, B, A). Free is white, occupied black and unknown
+ * a translucent grey.
+ */
+void colorize(const int8_t *src, int count, uint8_t *rgba);
+
+/*!
+ * Portable versions of the vectorized kernels above. They process the tails of the vectorized loops and are the
+ * reference the vectorized kernels are tested against.
+ */
+namespace scalar {
+void maxRows(const int8_t *src, size_t stride, int rows, int width, int8_t *out);
+
+void colorize(const int8_t *src, int count, uint8_t *rgba);
+}  // namespace scalar
+
+}  // namespace minimap_kernels
+
+#endif //MINIMAP_KERNELS_HPP
@@ -0,0 +1,96 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#include "minimap_layer.hpp"
+#include "minimap_kernels.hpp"
+
+#include <GL/gl.h>
+
+#include <algorithm>
+#include <cstring>
+
+MiniMapLayer::MiniMapLayer(const QRect &geometry) : OverlayLayer(geometry, Texture) {
+    raster_.pixels.assign(4 * geometry.width() * geometry.height(), 0);
+    memory_.set(MemoryAccount::Image, raster_.pixels.capacity());
+}
+
+void MiniMapLayer::setMap(const nav_msgs::msg::OccupancyGrid &map) {
+    markContentArrived();
+    // Copying and rasterizing a large map takes a while, the render thread only waits for the swap
+    Raster raster;
+    raster.grid_width = map.info.width;
+    raster.grid_height = map.info.height;
+    if (map.data.size() < size_t(raster.grid_width) * raster.grid_height) {
+        raster.grid_width = raster.grid_height = 0;
+    }
+    raster.grid.assign(map.data.begin(), map.data.begin() + size_t(raster.grid_width) * raster.grid_height);
+    const int width = geometry().width(), height = geometry().height();
+    raster.factor = std::max({1, (raster.grid_width + width - 1) / width, (raster.grid_height + height - 1) / height});
+    raster.out_width = (raster.grid_width + raster.factor - 1) / raster.factor;
+    raster.out_height = (raster.grid_height + raster.factor - 1) / raster.factor;
+    raster.row_max.resize(raster.grid_width);
+    raster.block_max.resize(raster.out_width);
+    raster.pixels.assign(4 * size_t(width) * height, 0);
+    rasterize(raster, width, 0, 0, raster.out_width, raster.out_height);
+    memory_.set(MemoryAccount::Image, raster.pixels.capacity() + raster.grid.capacity() + raster.row_max.capacity() +
+                                      raster.block_max.capacity());
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::swap(raster_, raster);
+        dirty_rect_ = QRect(0, 0, width, height);
+    }
+    // The previous raster is freed here, outside of the lock
+}
+
+void MiniMapLayer::applyUpdate(const map_msgs::msg::OccupancyGridUpdate &update) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int x0 = std::max(0, update.x), y0 = std::max(0, update.y);
+    const int x1 = std::min(raster_.grid_width, update.x + static_cast<int>(update.width));
+    const int y1 = std::min(raster_.grid_height, update.y + static_cast<int>(update.height));
+    if (x0 >= x1 || y0 >= y1 || update.data.size() < size_t(update.width) * update.height) return;
+    markContentArrived();
+    for (int y = y0; y < y1; ++y) {
+        const int8_t *src = update.data.data() + size_t(y - update.y) * update.width + (x0 - update.x);
+        std::memcpy(raster_.grid.data() + size_t(y) * raster_.grid_width + x0, src, x1 - x0);
+    }
+    const int factor = raster_.factor;
+    const int bx0 = x0 / factor, by0 = y0 / factor;
+    const int bx1 = (x1 + factor - 1) / factor, by1 = (y1 + factor - 1) / factor;
+    rasterize(raster_, geometry().width(), bx0, by0, bx1, by1);
+    // Map rows go up, image rows go down
+    dirty_rect_ |= QRect(bx0, raster_.out_height - by1, bx1 - bx0, by1 - by0);
+}
+
+bool MiniMapLayer::isDirty() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !dirty_rect_.isEmpty();
+}
+
+size_t MiniMapLayer::upload() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (dirty_rect_.isEmpty()) return 0;
+    const QRect &geometry = this->geometry();
+    const uint8_t *data = raster_.pixels.data() + 4 * (size_t(dirty_rect_.y()) * geometry.width() + dirty_rect_.x());
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, geometry.width());
+    glTexSubImage2D(GL_TEXTURE_2D, 0, geometry.x() + dirty_rect_.x(), geometry.y() + dirty_rect_.y(),
+                    dirty_rect_.width(), dirty_rect_.height(), GL_RGBA, GL_UNSIGNED_BYTE, data);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    const size_t bytes = 4 * size_t(dirty_rect_.width()) * dirty_rect_.height();
+    dirty_rect_ = QRect();
+    return bytes;
+}
+
+void MiniMapLayer::rasterize(Raster &raster, int stride, int x0, int y0, int x1, int y1) {
+    const int factor = raster.factor;
+    const int cell_x0 = x0 * factor, cell_x1 = std::min(raster.grid_width, x1 * factor);
+    for (int by = y0; by < y1; ++by) {
+        const int cell_y0 = by * factor;
+        const int rows = std::min(factor, raster.grid_height - cell_y0);
+        const int8_t *src = raster.grid.data() + size_t(cell_y0) * raster.grid_width + cell_x0;
+        minimap_kernels::maxRows(src, raster.grid_width, rows, cell_x1 - cell_x0, raster.row_max.data());
+        minimap_kernels::maxGroups(raster.row_max.data(), cell_x1 - cell_x0, factor, raster.block_max.data());
+        uint8_t *dst = raster.pixels.data() + 4 * (size_t(raster.out_height - 1 - by) * stride + x0);
+        minimap_kernels::colorize(raster.block_max.data(), x1 - x0, dst);
+    }
+}
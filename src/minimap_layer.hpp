@@ -0,0 +1,61 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#ifndef MINIMAP_LAYER_HPP
+#define MINIMAP_LAYER_HPP
+
+#include "memory_account.hpp"
+#include "overlay_layer.hpp"
+
+#include <map_msgs/msg/occupancy_grid_update.hpp>
+#include <nav_msgs/msg/occupancy_grid.hpp>
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/*!
+ * Mini-map showing an occupancy grid downsampled to fit the layer.
+ * Map updates are applied incrementally: only the blocks covered by an update are rasterized again and only the
+ * changed sub-rectangle is uploaded to the overlay texture.
+ */
+class MiniMapLayer : public OverlayLayer {
+public:
+    explicit MiniMapLayer(const QRect &geometry);
+
+    void setMap(const nav_msgs::msg::OccupancyGrid &map);
+
+    void applyUpdate(const map_msgs::msg::OccupancyGridUpdate &update);
+
+    bool isDirty() const override;
+
+    size_t upload() override;
+
+private:
+    //! The grid and its downsampled image. setMap builds a new one without holding the mutex and swaps it in.
+    struct Raster {
+        std::vector<int8_t> grid;
+        int grid_width = 0;
+        int grid_height = 0;
+        //! Number of grid cells per output pixel along each axis.
+        int factor = 1;
+        int out_width = 0;
+        int out_height = 0;
+        //! RGBA pixels of the whole layer, top row first.
+        std::vector<uint8_t> pixels;
+        std::vector<int8_t> row_max;
+        std::vector<int8_t> block_max;
+    };
+
+    //! Rasterizes the output blocks [x0, x1) x [y0, y1) in map orientation (y up) into an image of the given width.
+    static void rasterize(Raster &raster, int stride, int x0, int y0, int x1, int y1);
+
+    mutable std::mutex mutex_;
+    Raster raster_;
+    //! Part of the layer that changed since the last upload in layer coordinates.
+    QRect dirty_rect_;
+    MemoryAccount memory_{"minimap"};
+};
+
+#endif //MINIMAP_LAYER_HPP
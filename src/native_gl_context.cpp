@@ -0,0 +1,43 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#include "native_gl_context.hpp"
+
+#include <EGL/egl.h>
+#include <GL/glx.h>
+
+NativeGLContext NativeGLContext::current() {
+    NativeGLContext result;
+    if (GLXContext context = glXGetCurrentContext()) {
+        result.api_ = Glx;
+        result.display_ = glXGetCurrentDisplay();
+        result.context_ = context;
+        result.glx_draw_ = glXGetCurrentDrawable();
+        result.glx_read_ = glXGetCurrentReadDrawable();
+        return result;
+    }
+    EGLContext context = eglGetCurrentContext();
+    if (context == EGL_NO_CONTEXT) return result;
+    result.api_ = Egl;
+    result.display_ = eglGetCurrentDisplay();
+    result.context_ = context;
+    result.egl_draw_ = eglGetCurrentSurface(EGL_DRAW);
+    result.egl_read_ = eglGetCurrentSurface(EGL_READ);
+    return result;
+}
+
+void NativeGLContext::makeCurrent() const {
+    switch (api_) {
+        case Glx:
+            glXMakeContextCurrent(static_cast<::Display *>(display_), glx_draw_, glx_read_,
+                                  static_cast<GLXContext>(context_));
+            break;
+        case Egl:
+            eglMakeCurrent(static_cast<EGLDisplay>(display_), static_cast<EGLSurface>(egl_draw_),
+                           static_cast<EGLSurface>(egl_read_), static_cast<EGLContext>(context_));
+            break;
+        case None:
+            break;
+    }
+}
@@ -0,0 +1,41 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#ifndef NATIVE_GL_CONTEXT_HPP
+#define NATIVE_GL_CONTEXT_HPP
+
+/*!
+ * A GL context of the window system API, GLX or EGL, that was current on the calling thread.
+ * The QOpenGLWrapper draws in its own Qt context and uses this to make the context of the caller, e.g., Ogre's GLX
+ * context in rviz or an EGL context of the headless benchmark, current again.
+ */
+class NativeGLContext {
+public:
+    enum Api {
+        None,
+        Glx,
+        Egl
+    };
+
+    //! Captures the context that is current on the calling thread. GLX is checked first.
+    static NativeGLContext current();
+
+    Api api() const { return api_; }
+
+    //! Makes the captured context current again. Does nothing if no context was current.
+    void makeCurrent() const;
+
+private:
+    Api api_ = None;
+    void *display_ = nullptr;
+    void *context_ = nullptr;
+    //! GLXDrawables, GLX only.
+    unsigned long glx_draw_ = 0;
+    unsigned long glx_read_ = 0;
+    //! EGLSurfaces, EGL only. EGL_NO_SURFACE for surfaceless contexts.
+    void *egl_draw_ = nullptr;
+    void *egl_read_ = nullptr;
+};
+
+#endif //NATIVE_GL_CONTEXT_HPP
@@ -0,0 +1,87 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#include "ogre_overlay.hpp"
+
+#include <Overlay/OgreOverlay.h>
+#include <Overlay/OgreOverlayManager.h>
+#include <Overlay/OgrePanelOverlayElement.h>
+#include <RenderSystems/GL/OgreGLTexture.h>
+#include <OgreHardwarePixelBuffer.h>
+#include <OgreMaterialManager.h>
+#include <OgrePass.h>
+#include <OgreSceneManager.h>
+#include <OgreTechnique.h>
+#include <OgreTextureManager.h>
+
+#include <cstdint>
+#include <string>
+
+OgreOverlay createOgreOverlay(Ogre::SceneManager *scene_manager, int width, int height) {
+    // Ogre resources are created on the render thread only
+    static unsigned int instance = 0;
+    const std::string name = "hector_rviz_overlay" + (instance == 0 ? std::string() : "_" + std::to_string(instance));
+    ++instance;
+    Ogre::MaterialPtr material = Ogre::MaterialManager::getSingleton().create(
+            name + "_OverlayMaterial", Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+    material->getTechnique(0)->getPass(0)->setSceneBlending(Ogre::SBT_TRANSPARENT_ALPHA);
+    // Create a texture from an array
+    Ogre::TexturePtr texture = Ogre::TextureManager::getSingleton().createManual(
+            name + "_Texture", Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,
+            Ogre::TEX_TYPE_2D, width, height, 0, Ogre::PF_R8G8B8A8, Ogre::TU_DYNAMIC_WRITE_ONLY);
+
+    // Lock the texture buffer for writing
+    Ogre::HardwarePixelBufferSharedPtr pixel_buffer = texture->getBuffer();
+    pixel_buffer->lock(Ogre::HardwareBuffer::HBL_DISCARD);
+    const Ogre::PixelBox &pixel_box = pixel_buffer->getCurrentLock();
+
+    // Fill with a test pattern until the layers draw
+    auto *pixels = static_cast<uint8_t *>(pixel_box.data);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            int index = y * width + x;
+            pixels[index * 4 + 0] = index % 255;
+            pixels[index * 4 + 1] = (index + 100) % 255;
+            pixels[index * 4 + 2] = (index + 50) % 255;
+            pixels[index * 4 + 3] = 200;
+        }
+    }
+    pixel_buffer->unlock();
+
+    OgreOverlay result;
+    auto *gl_texture = dynamic_cast<Ogre::GLTexture *>(texture.get());
+    result.listener = new OverlayListener(width, height, gl_texture->getGLID());
+    result.composite_listener = new CompositeListener(result.listener->wrapper());
+    scene_manager->addRenderQueueListener(result.composite_listener);
+
+    // Set the texture to the material
+    material->getTechnique(0)->getPass(0)->createTextureUnitState(texture->getName());
+
+    Ogre::OverlayManager &overlay_manager = Ogre::OverlayManager::getSingleton();
+    result.overlay = overlay_manager.create(name);
+    result.panel = dynamic_cast<Ogre::PanelOverlayElement *>(
+            overlay_manager.createOverlayElement("Panel", name + "_Panel"));
+    result.panel->setPosition(0, 0);
+    result.panel->setDimensions(0.5, 0.5);
+    result.panel->setMaterialName(material->getName());
+    result.overlay->add2D(result.panel);
+    result.overlay->show();
+    result.material = std::move(material);
+    result.texture = std::move(texture);
+    return result;
+}
+
+void destroyOgreOverlay(Ogre::SceneManager *scene_manager, OgreOverlay &overlay) {
+    if (overlay.listener == nullptr) return;
+    scene_manager->removeRenderQueueListener(overlay.composite_listener);
+    delete overlay.composite_listener;
+    delete overlay.listener;
+    Ogre::OverlayManager &overlay_manager = Ogre::OverlayManager::getSingleton();
+    // The panel references the material by name and the material the texture
+    overlay_manager.destroy(overlay.overlay);
+    overlay_manager.destroyOverlayElement(overlay.panel);
+    Ogre::MaterialManager::getSingleton().remove(overlay.material);
+    Ogre::TextureManager::getSingleton().remove(overlay.texture);
+    overlay = OgreOverlay();
+}
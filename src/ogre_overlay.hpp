@@ -0,0 +1,83 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#ifndef OGRE_OVERLAY_HPP
+#define OGRE_OVERLAY_HPP
+
+#include "qopengl_wrapper.hpp"
+
+#include <OgrePrerequisites.h>
+#include <OgreRenderQueue.h>
+#include <OgreRenderQueueListener.h>
+#include <OgreRenderTargetListener.h>
+
+namespace Ogre {
+class Overlay;
+class PanelOverlayElement;
+class SceneManager;
+}
+
+//! Draws the overlay into its texture after the viewports of the render target it was added to were updated.
+class OverlayListener : public Ogre::RenderTargetListener {
+public:
+    OverlayListener(int width, int height, unsigned int texture_id) : wrapper_(width, height, texture_id) {}
+
+    void postViewportUpdate(const Ogre::RenderTargetViewportEvent &) override {
+        wrapper_.framePacing().recordFrame();
+        wrapper_.draw();
+    }
+
+    QOpenGLWrapper &wrapper() { return wrapper_; }
+
+private:
+    QOpenGLWrapper wrapper_;
+};
+
+//! Measures the GPU time of rendering the overlay render queue which contains the overlay panel.
+class CompositeListener : public Ogre::RenderQueueListener {
+public:
+    explicit CompositeListener(QOpenGLWrapper &wrapper) : wrapper_(wrapper) {}
+
+    void renderQueueStarted(Ogre::uint8 queue_group_id, const Ogre::String &, bool &) override {
+        if (queue_group_id == Ogre::RENDER_QUEUE_OVERLAY) wrapper_.beginComposite();
+    }
+
+    void renderQueueEnded(Ogre::uint8 queue_group_id, const Ogre::String &, bool &) override {
+        if (queue_group_id == Ogre::RENDER_QUEUE_OVERLAY) wrapper_.endComposite();
+    }
+
+private:
+    QOpenGLWrapper &wrapper_;
+};
+
+//! The Ogre objects of the overlay created by createOgreOverlay and released by destroyOgreOverlay.
+struct OgreOverlay {
+    //! Has to be added to the render target the overlay is shown on.
+    OverlayListener *listener = nullptr;
+    CompositeListener *composite_listener = nullptr;
+    Ogre::Overlay *overlay = nullptr;
+    //! Covers the top left quarter of the viewport. May be moved and resized.
+    Ogre::PanelOverlayElement *panel = nullptr;
+    Ogre::MaterialPtr material;
+    Ogre::TexturePtr texture;
+};
+
+/*!
+ * Creates the texture, material and overlay panel that show the overlay and the listeners that draw it.
+ * Does not depend on rviz, so the same setup is used by the display and the offscreen test harness.
+ *
+ * Has to be called before the overlay system is added to the scene manager, e.g., by rviz_rendering's
+ * prepareOverlays, so the composite measurement includes the overlay system's rendering. The overlay is shown.
+ * The Ogre resources have unique names, hence, any number of overlays can exist at the same time.
+ */
+OgreOverlay createOgreOverlay(Ogre::SceneManager *scene_manager, int width, int height);
+
+/*!
+ * Destroys the listeners, the Qt context drawing the overlay and the Ogre overlay, panel, material and texture.
+ * The listener has to be removed from the render target before. Call with Ogre's context current, so the GPU
+ * timer queries of the upload are released as well. Resets the overlay, does nothing if it was already destroyed.
+ */
+void destroyOgreOverlay(Ogre::SceneManager *scene_manager, OgreOverlay &overlay);
+
+#endif //OGRE_OVERLAY_HPP
@@ -0,0 +1,92 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#ifndef OVERLAY_LAYER_HPP
+#define OVERLAY_LAYER_HPP
+
+#include <QRect>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+class QPainter;
+
+/*!
+ * A rectangular part of the overlay texture that is filled by a single content producer.
+ * Layers are drawn by the QOpenGLWrapper on the render thread, content may be produced on any thread.
+ * Layers must not overlap.
+ */
+class OverlayLayer {
+public:
+    enum Target {
+        //! The layer is painted with a QPainter into the offscreen framebuffer which is then read back.
+        Painter,
+        //! The layer writes its pixels directly into the overlay texture.
+        Texture
+    };
+
+    explicit OverlayLayer(const QRect &geometry, Target target = Painter) : geometry_(geometry), target_(target) {}
+
+    virtual ~OverlayLayer() = default;
+
+    /*!
+     * The region of the overlay texture this layer draws to in pixels.
+     */
+    const QRect &geometry() const { return geometry_; }
+
+    Target target() const { return target_; }
+
+    /*!
+     * Called by the QOpenGLWrapper on the render thread at the start of every draw before the dirty checks, e.g., to
+     * acquire or release the resources the layer's content is read from.
+     */
+    virtual void poll() {}
+
+    /*!
+     * @return True if the layer has content that was not drawn yet. Layers that are not dirty are skipped.
+     */
+    virtual bool isDirty() const = 0;
+
+    /*!
+     * Paints a Painter layer. The painter is translated to the top left corner of the layer and clipped to its
+     * geometry. The region is cleared to transparent before this is called.
+     */
+    virtual void paint(QPainter &) {}
+
+    /*!
+     * Uploads the changed part of a Texture layer. Called with the render system's context current and the overlay
+     * texture bound to GL_TEXTURE_2D. Unpack state that is changed has to be restored.
+     * @return The number of bytes uploaded.
+     */
+    virtual size_t upload() { return 0; }
+
+    /*!
+     * Called by the QOpenGLWrapper when the layer is drawn.
+     * @return The arrival time of the oldest content that was not drawn yet or the epoch if the layer does not
+     *   record arrivals. Resets the arrival.
+     */
+    std::chrono::steady_clock::time_point takeContentArrival() {
+        using Clock = std::chrono::steady_clock;
+        return Clock::time_point(Clock::duration(content_arrival_.exchange(0)));
+    }
+
+protected:
+    /*!
+     * Records that new content arrived now for the content latency of the frame pacing analysis.
+     * Thread-safe. If earlier content was not drawn yet, its arrival is kept.
+     */
+    void markContentArrived() {
+        std::chrono::steady_clock::rep expected = 0;
+        content_arrival_.compare_exchange_strong(expected,
+                                                 std::chrono::steady_clock::now().time_since_epoch().count());
+    }
+
+private:
+    QRect geometry_;
+    Target target_;
+    std::atomic<std::chrono::steady_clock::rep> content_arrival_{0};
+};
+
+#endif //OVERLAY_LAYER_HPP
@@ -1,22 +1,29 @@
 #include "overlay_test/overlay_test.hpp"
+#include "console_layer.hpp"
+#include "memory_account.hpp"
+#include "minimap_layer.hpp"
+#include "ogre_overlay.hpp"
+#include "performance_hud_layer.hpp"
+#include "point_cloud_layer.hpp"
+#include "shared_memory_layer.hpp"
 #include "qopengl_wrapper.hpp"
+#include "profile.hpp"
+#include "timer_stats_publisher.hpp"
 #include <rclcpp/rclcpp.hpp>
+#include <rcl_interfaces/msg/log.hpp>
+#include <map_msgs/msg/occupancy_grid_update.hpp>
+#include <nav_msgs/msg/occupancy_grid.hpp>
+#include <sensor_msgs/msg/point_cloud2.hpp>
+#include <std_srvs/srv/trigger.hpp>
+#include <rviz_common/display_context.hpp>
+#include <rviz_common/properties/bool_property.hpp>
+#include <rviz_common/properties/float_property.hpp>
+#include <rviz_common/ros_integration/ros_node_abstraction_iface.hpp>
 #include "rviz_wrapper.h"
 
-#include <Overlay/OgreOverlayManager.h>
-#include <Overlay/OgreOverlay.h>
-#include <Overlay/OgrePanelOverlayElement.h>
-#include <RenderSystems/GL/OgreGLHardwarePixelBuffer.h>
-#include <RenderSystems/GL/OgreGLTexture.h>
-#include <OgreHardwarePixelBuffer.h>
-#include <OgreMaterialManager.h>
-#include <OgreRectangle2D.h>
-#include <OgreRenderQueue.h>
-#include <OgreRenderTargetListener.h>
-#include <OgreSceneNode.h>
-#include <OgreTechnique.h>
-#include <OgreTextureManager.h>
-#include <OgrePass.h>
+#include <unistd.h>
+
+#include <iostream>
 
 
 
@@ -25,84 +32,118 @@ namespace overlay_test
 
 OverlayTestDisplay::OverlayTestDisplay()
 {
+  stats_rate_property_ = new rviz_common::properties::FloatProperty(
+    "Stats Rate", 1.0f,
+    "Rate in Hz at which the timer statistics of the last window are published on /diagnostics. "
+    "0 disables publishing.", this);
+  stats_rate_property_->setMin(0);
+  gpu_memory_budget_property_ = new rviz_common::properties::FloatProperty(
+    "GPU Memory Budget", 0.0f,
+    "GPU memory in MB the overlay resources may use before the memory status on /diagnostics turns into a "
+    "warning. 0 disables the budget.", this);
+  gpu_memory_budget_property_->setMin(0);
+  performance_hud_property_ = new rviz_common::properties::BoolProperty(
+    "Performance HUD", false, "Shows frame timings and upload statistics of the overlay.", this);
 }
 
 OverlayTestDisplay::~OverlayTestDisplay()
 {
-}
-
-  class Listener : public Ogre::RenderTargetListener {
-public:
-  Listener(int width, int height, GLuint texture_id) : wrapper_(width, height, texture_id) {}
-
-  void postViewportUpdate(const Ogre::RenderTargetViewportEvent &) override {
-    wrapper_.draw();
+#ifdef HECTOR_TIMEIT_PROFILING
+  // Printed at exit like the summaries of the profiling scopes, which also only exist in profiling builds
+  if (frame_pacing_ != nullptr) {
+    std::cout << frame_pacing_->report().toString() << MemoryAccount::report() << std::flush;
   }
-
-private:
-  QOpenGLWrapper wrapper_;
-};
+#endif
+  // Read the frame pacing of the overlay
+  stats_publisher_.reset();
+  performance_hud_timer_.reset();
+  if (ogre_overlay_ != nullptr) {
+    removeRenderTargetListener(context_, ogre_overlay_->listener);
+    destroyOgreOverlay(scene_manager_, *ogre_overlay_);
+  }
+}
 
 void OverlayTestDisplay::onInitialize()
 {
-  Ogre::MaterialPtr material_ = Ogre::MaterialManager::getSingleton().create("hector_rviz_overlay_OverlayMaterial", Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
-  material_->getTechnique(0)->getPass(0)->setSceneBlending(Ogre::SBT_TRANSPARENT_ALPHA);
-  const int width = 200, height=200;
-  // Create a texture from an array
-  Ogre::TexturePtr texture = Ogre::TextureManager::getSingleton().createManual(
-    "my_texture", Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,
-    Ogre::TEX_TYPE_2D, width, height, 0, Ogre::PF_R8G8B8A8, Ogre::TU_DYNAMIC_WRITE_ONLY);
-
-  // Lock the texture buffer for writing
-  Ogre::HardwarePixelBufferSharedPtr pixelBuffer = texture->getBuffer();
-  pixelBuffer->lock(Ogre::HardwareBuffer::HBL_DISCARD);
-  const Ogre::PixelBox& pixelBox = pixelBuffer->getCurrentLock();
+  const int width = 1024, height = 768;
+  ogre_overlay_ = std::make_unique<OgreOverlay>(createOgreOverlay(scene_manager_, width, height));
+  OverlayListener *listener = ogre_overlay_->listener;
+
+  rclcpp::Node::SharedPtr node = context_->getRosNodeAbstraction().lock()->get_raw_node();
+  auto console_layer = std::make_shared<ConsoleLayer>(QRect(0, height - 256, width, 256));
+  listener->wrapper().addLayer(console_layer);
+  subscriptions_.push_back(node->create_subscription<rcl_interfaces::msg::Log>(
+    "/rosout", rclcpp::QoS(1000),
+    [console_layer](rcl_interfaces::msg::Log::UniquePtr msg) {
+      console_layer->addLine(msg->name, msg->level, std::move(msg->msg));
+    }));
+  auto minimap_layer = std::make_shared<MiniMapLayer>(QRect(width - 256, 0, 256, 256));
+  listener->wrapper().addLayer(minimap_layer);
+  subscriptions_.push_back(node->create_subscription<nav_msgs::msg::OccupancyGrid>(
+    "/map", rclcpp::QoS(1).transient_local(),
+    [minimap_layer](nav_msgs::msg::OccupancyGrid::ConstSharedPtr msg) {
+      minimap_layer->setMap(*msg);
+    }));
+  subscriptions_.push_back(node->create_subscription<map_msgs::msg::OccupancyGridUpdate>(
+    "/map_updates", rclcpp::QoS(10),
+    [minimap_layer](map_msgs::msg::OccupancyGridUpdate::ConstSharedPtr msg) {
+      minimap_layer->applyUpdate(*msg);
+    }));
+  auto point_cloud_layer = std::make_shared<PointCloudLayer>(QRect(width - 256, 256, 256, 256), 25.f);
+  listener->wrapper().addLayer(point_cloud_layer);
+  subscriptions_.push_back(node->create_subscription<sensor_msgs::msg::PointCloud2>(
+    "/points", rclcpp::SensorDataQoS(),
+    [point_cloud_layer](sensor_msgs::msg::PointCloud2::ConstSharedPtr msg) {
+      point_cloud_layer->setCloud(std::move(msg));
+    }));
+  listener->wrapper().addLayer(std::make_shared<SharedMemoryLayer>(QRect(0, 0, 640, 480), "/overlay_test_frames"));
+  performance_hud_layer_ = std::make_shared<PerformanceHudLayer>(QRect(640, 0, 128, 512));
+  performance_hud_layer_->setEnabled(performance_hud_property_->getBool());
+  listener->wrapper().addLayer(performance_hud_layer_);
+  frame_pacing_ = &listener->wrapper().framePacing();
+  performance_hud_layer_->setFramePacing(frame_pacing_);
+  performance_hud_timer_ = node->create_wall_timer(
+    performance_hud_layer_->refreshInterval(),
+    [hud = performance_hud_layer_.get()] {
+      hud->sample();
+    });
+  listener->wrapper().setFrameCallback(
+    [hud = performance_hud_layer_.get()](const QOpenGLWrapper::FrameStatistics &stats) {
+      hud->addFrame(stats);
+    });
+
+#ifdef HECTOR_TIMEIT_PROFILING
+  // Keeps roughly the last minute of frames per thread which can be loaded into Perfetto or chrome://tracing
+  hector_timeit::TraceRecorder::enable();
+  dump_trace_service_ = node->create_service<std_srvs::srv::Trigger>(
+    "overlay_test/dump_trace",
+    [](const std::shared_ptr<std_srvs::srv::Trigger::Request>,
+       std::shared_ptr<std_srvs::srv::Trigger::Response> response) {
+      const std::string path = "/tmp/overlay_test_trace_" + std::to_string(getpid()) + "_" +
+        std::to_string(std::chrono::system_clock::now().time_since_epoch().count()) + ".json";
+      response->success = hector_timeit::TraceRecorder::writeJson(path);
+      response->message = response->success ? path : "Failed to write " + path;
+    });
+#endif
+  addRenderTargetListener(context_, listener);
+
+  stats_publisher_ = std::make_unique<TimerStatsPublisher>(node, "/diagnostics");
+  stats_publisher_->setFramePacing(frame_pacing_);
+  stats_publisher_->setGpuMemoryBudget(
+    static_cast<size_t>(gpu_memory_budget_property_->getFloat() * 1024 * 1024));
+  stats_publisher_->setRate(stats_rate_property_->getFloat());
 
-  // Get a pointer to the pixel data
-  uint8_t* pixels = static_cast<uint8_t*>(pixelBox.data);
-
-  // Populate the pixel data from your array
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      // Assuming your array is a 1D array
-      int index = y * width + x;
+  prepareOverlays(scene_manager_);
+}
 
-      // Set the pixel color values
-      pixels[index * 4 + 0] = index % 255/* red component */;
-      pixels[index * 4 + 1] = (index + 100) % 255/* green component */;
-      pixels[index * 4 + 2] = (index + 50) % 255/* blue component */;
-      pixels[index * 4 + 3] = 200/* alpha component */;
-    }
+void OverlayTestDisplay::update(float, float)
+{
+  if (stats_publisher_ != nullptr) {
+    stats_publisher_->setRate(stats_rate_property_->getFloat());
+    stats_publisher_->setGpuMemoryBudget(
+      static_cast<size_t>(gpu_memory_budget_property_->getFloat() * 1024 * 1024));
   }
-  Ogre::GLHardwarePixelBuffer *glBuffer = dynamic_cast<Ogre::GLHardwarePixelBuffer*>(pixelBuffer.get());
-  Ogre::GLTexture *glTexture = dynamic_cast<Ogre::GLTexture*>(texture.get());
-  RCLCPP_INFO(rclcpp::get_logger("OverlayTestDisplay"), "GL Texture: %p, GL Buffer %p", (void*)glTexture, (void*)glBuffer);
-
-  // Unlock the texture buffer
-  pixelBuffer->unlock();
-  addRenderTargetListener(context_, new Listener(width, height, glTexture->getGLID()));
-
-  // Set the texture to the material
-  material_->getTechnique(0)->getPass(0)->createTextureUnitState("my_texture");
-  // Ogre::Rectangle2D *rect = new Ogre::Rectangle2D(true);
-  // rect->setCorners(-1.0, 0.0, 0.0, -1.0);
-  // rect->setRenderQueueGroup(Ogre::RENDER_QUEUE_OVERLAY);
-  // Ogre::AxisAlignedBox aabInf;
-  // aabInf.setInfinite();
-  // rect->setBoundingBox(aabInf);
-  // rect->setMaterial(material_);
-  // scene_node_->attachObject(rect);
-
-  prepareOverlays(scene_manager_);
-  Ogre::OverlayManager &overlay_manager = Ogre::OverlayManager::getSingleton();
-  Ogre::Overlay *overlay_ = overlay_manager.create("hector_rviz_overlay");
-  Ogre::PanelOverlayElement *overlay_panel_ = dynamic_cast<Ogre::PanelOverlayElement *>(overlay_manager.createOverlayElement("Panel", "hector_rviz_overlay_Panel"));
-  overlay_panel_->setPosition(0, 0);
-  overlay_panel_->setDimensions(0.5, 0.5);
-  overlay_panel_->setMaterialName("hector_rviz_overlay_OverlayMaterial" );
-  // overlay_panel_->setMaterial(clearMat);
-  overlay_->add2D(overlay_panel_);
-  overlay_->show();
+  if (performance_hud_layer_ != nullptr) performance_hud_layer_->setEnabled(performance_hud_property_->getBool());
 }
 
 }  // namespace overlay_test
@@ -0,0 +1,207 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#include "performance_hud_layer.hpp"
+#include "allocation_tracker.hpp"
+#include "concurrent_timer.hpp"
+
+#include <QFontMetrics>
+#include <QPainter>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr int MARGIN = 4;
+constexpr int GRAPH_HEIGHT = 96;
+//! Frame time shown at the full height of the graph.
+constexpr long GRAPH_RANGE = 33333333;
+constexpr long FRAME_60HZ = 16666667;
+
+QString milliseconds(double nanoseconds) {
+    return QString::number(nanoseconds / 1e6, 'f', 2);
+}
+}
+
+PerformanceHudLayer::PerformanceHudLayer(const QRect &geometry, std::chrono::milliseconds refresh_interval)
+        : OverlayLayer(geometry), font_("Monospace"), refresh_interval_(refresh_interval),
+          window_start_(std::chrono::steady_clock::now()),
+          graph_(std::max(1, geometry.width() - 2 * MARGIN), std::max(1, std::min(GRAPH_HEIGHT, geometry.height() / 2)),
+                 QImage::Format_ARGB32_Premultiplied) {
+    font_.setStyleHint(QFont::TypeWriter);
+    font_.setPointSize(8);
+    line_height_ = std::max(1, QFontMetrics(font_).height());
+    graph_.fill(Qt::transparent);
+    history_.resize(graph_.width());
+    memory_.set(MemoryAccount::Image,
+                size_t(graph_.bytesPerLine()) * graph_.height() + history_.capacity() * sizeof(long));
+}
+
+void PerformanceHudLayer::addFrame(const QOpenGLWrapper::FrameStatistics &stats) {
+    history_[recorded_ % history_.size()] = stats.frame_time;
+    ++recorded_;
+    ++window_.frames;
+    window_.max_frame_time = std::max(window_.max_frame_time, stats.frame_time);
+    window_.frame_time += stats.frame_time;
+    window_.paint_time += stats.paint_time;
+    window_.readback_time += stats.readback_time;
+    window_.upload_time += stats.upload_time;
+    window_.uploaded_bytes += stats.uploaded_bytes;
+    window_.allocations += stats.allocations;
+    window_.allocated_bytes += stats.allocated_bytes;
+    // The wrapper's counters are cumulative
+    window_.skipped_frames += stats.skipped_frames - last_.skipped_frames;
+    window_.coalesced_updates += stats.coalesced_updates - last_.coalesced_updates;
+    last_ = stats;
+}
+
+void PerformanceHudLayer::setFramePacing(const FramePacingAnalyzer *frame_pacing) {
+    frame_pacing_ = frame_pacing;
+}
+
+void PerformanceHudLayer::sample() {
+    if (!enabled_) {
+        // Runs while the layer was disabled do not belong to the first window shown after enabling it
+        sampling_ = false;
+        return;
+    }
+    Sample sample;
+    std::unordered_map<size_t, hector_timeit::RunStatistics> timer_stats;
+    hector_timeit::ConcurrentTimer::forEach([&](const hector_timeit::ConcurrentTimer &timer) {
+        hector_timeit::RunStatistics stats = timer.getRunStatistics();
+        auto previous = previous_timer_stats_.find(timer.id());
+        const hector_timeit::RunStatistics window =
+                previous == previous_timer_stats_.end() ? stats : stats.since(previous->second);
+        timer_stats.emplace(timer.id(), std::move(stats));
+        if (!sampling_ || window.count() == 0) return;
+        sample.timer_lines.push_back(QString::fromStdString(timer.name()).left(13).leftJustified(14) +
+                                     milliseconds(window.mean()));
+    });
+    previous_timer_stats_ = std::move(timer_stats);
+    sampling_ = true;
+
+    if (const FramePacingAnalyzer *frame_pacing = frame_pacing_) {
+        // Over the frames in the analyzer's ring, not only since the last sample
+        const FramePacingAnalyzer::Report pacing = frame_pacing->report();
+        sample.pacing_lines.push_back(QStringLiteral("jitter ") + milliseconds(pacing.jitter()) +
+                                      QStringLiteral(" ms"));
+        sample.pacing_lines.push_back(QStringLiteral("stall  ") + milliseconds(pacing.intervals.max()) +
+                                      QStringLiteral(" ms"));
+        sample.pacing_lines.push_back(QStringLiteral("late   ") + QString::number(pacing.over_budget));
+        if (pacing.content_latency.count() > 0) {
+            sample.pacing_lines.push_back(QStringLiteral("lat99  ") +
+                                          milliseconds(pacing.content_latency.percentile(99)) + QStringLiteral(" ms"));
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(sample_mutex_);
+    std::swap(sample_, sample);
+    sample_taken_ = true;
+}
+
+void PerformanceHudLayer::setEnabled(bool enabled) {
+    if (enabled_.exchange(enabled) != enabled) enabled_changed_ = true;
+}
+
+bool PerformanceHudLayer::isDirty() const {
+    if (enabled_changed_) return true;
+    return enabled_ && std::chrono::steady_clock::now() >= next_paint_;
+}
+
+void PerformanceHudLayer::paint(QPainter &painter) {
+    const auto now = std::chrono::steady_clock::now();
+    next_paint_ = now + refresh_interval_;
+    enabled_changed_ = false;
+    // The region was already cleared
+    if (!enabled_) {
+        shown_ = false;
+        return;
+    }
+    if (!shown_) {
+        // Frames and timer runs while the layer was disabled do not belong to the window, it is shown from the
+        // next repaint on
+        resetWindow(now);
+        shown_ = true;
+        return;
+    }
+    updateGraph();
+    const double window_seconds = std::max(1e-3, std::chrono::duration<double>(now - window_start_).count());
+    window_start_ = now;
+
+    {
+        std::lock_guard<std::mutex> lock(sample_mutex_);
+        if (sample_taken_) std::swap(shown_sample_, sample_);
+        sample_taken_ = false;
+    }
+
+    painter.fillRect(QRect(QPoint(0, 0), geometry().size()), QColor(0, 0, 0, 160));
+    painter.drawImage(MARGIN, MARGIN, graph_);
+    const int frame_60hz_y = MARGIN + graph_.height() - static_cast<int>(graph_.height() * FRAME_60HZ / GRAPH_RANGE);
+    painter.setPen(QColor(255, 255, 255, 90));
+    painter.drawLine(MARGIN, frame_60hz_y, MARGIN + graph_.width() - 1, frame_60hz_y);
+
+    painter.setFont(font_);
+    painter.setPen(QColor(230, 230, 230));
+    int y = MARGIN + graph_.height() + line_height_;
+    auto line = [&](const QString &text) {
+        if (y > geometry().height() - MARGIN) return;
+        painter.drawText(MARGIN, y, text);
+        y += line_height_;
+    };
+    const double frames = std::max<uint64_t>(1, window_.frames);
+    line(QStringLiteral("frame  ") + milliseconds(window_.frame_time / frames) + QStringLiteral(" ms"));
+    line(QStringLiteral("max    ") + milliseconds(window_.max_frame_time) + QStringLiteral(" ms"));
+    line(QStringLiteral("rate   ") + QString::number(window_.frames / window_seconds, 'f', 1) + QStringLiteral(" Hz"));
+    line(QStringLiteral("paint  ") + milliseconds(window_.paint_time / frames) + QStringLiteral(" ms"));
+    line(QStringLiteral("read   ") + milliseconds(window_.readback_time / frames) + QStringLiteral(" ms"));
+    line(QStringLiteral("upload ") + milliseconds(window_.upload_time / frames) + QStringLiteral(" ms"));
+    line(QStringLiteral("       ") + QString::number(window_.uploaded_bytes / window_seconds / 1e6, 'f', 1) +
+         QStringLiteral(" MB/s"));
+    line(QStringLiteral("skip   ") + QString::number(window_.skipped_frames));
+    line(QStringLiteral("coal   ") + QString::number(window_.coalesced_updates));
+    for (const QString &text : shown_sample_.pacing_lines) line(text);
+    if (hector_timeit::AllocationTracker::isAvailable()) {
+        line(QStringLiteral("alloc  ") + QString::number(window_.allocations / frames, 'f', 1) +
+             QStringLiteral("/frame"));
+        line(QStringLiteral("       ") + QString::number(window_.allocated_bytes / frames / 1e3, 'f', 1) +
+             QStringLiteral(" kB/frame"));
+    }
+    const MemoryAccount::Usage memory = MemoryAccount::total();
+    line(QStringLiteral("gpu    ") + QString::number(memory.gpu_bytes / 1048576.0, 'f', 1) + QStringLiteral(" MB"));
+    line(QStringLiteral("cpu    ") + QString::number(memory.cpu_bytes / 1048576.0, 'f', 1) + QStringLiteral(" MB"));
+    painter.setPen(QColor(150, 150, 150));
+    for (const QString &text : shown_sample_.timer_lines) line(text);
+    window_ = Window();
+}
+
+void PerformanceHudLayer::resetWindow(std::chrono::steady_clock::time_point now) {
+    window_ = Window();
+    window_start_ = now;
+    // Samples taken while the layer was hidden are outdated
+    shown_sample_.pacing_lines.clear();
+    shown_sample_.timer_lines.clear();
+    std::lock_guard<std::mutex> lock(sample_mutex_);
+    sample_taken_ = false;
+}
+
+void PerformanceHudLayer::updateGraph() {
+    const int width = graph_.width(), height = graph_.height();
+    const int columns = static_cast<int>(std::min<uint64_t>(recorded_ - drawn_, width));
+    drawn_ = recorded_;
+    if (columns == 0) return;
+    for (int y = 0; y < height; ++y) {
+        auto *row = reinterpret_cast<QRgb *>(graph_.scanLine(y));
+        std::memmove(row, row + columns, sizeof(QRgb) * (width - columns));
+        std::fill(row + width - columns, row + width, 0);
+    }
+    for (int i = 0; i < columns; ++i) {
+        const long time = history_[(recorded_ - columns + i) % history_.size()];
+        const int bar = std::max(1, static_cast<int>(std::min<long>(time, GRAPH_RANGE) * height / GRAPH_RANGE));
+        const QRgb color = time <= FRAME_60HZ    ? qPremultiply(qRgba(80, 220, 80, 220))
+                           : time <= GRAPH_RANGE ? qPremultiply(qRgba(255, 200, 60, 220))
+                                                 : qPremultiply(qRgba(255, 80, 80, 220));
+        const int x = width - columns + i;
+        for (int y = height - bar; y < height; ++y) reinterpret_cast<QRgb *>(graph_.scanLine(y))[x] = color;
+    }
+}
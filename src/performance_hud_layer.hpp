@@ -0,0 +1,123 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#ifndef PERFORMANCE_HUD_LAYER_HPP
+#define PERFORMANCE_HUD_LAYER_HPP
+
+#include "frame_pacing.hpp"
+#include "memory_account.hpp"
+#include "overlay_layer.hpp"
+#include "qopengl_wrapper.hpp"
+#include "timer.hpp"
+
+#include <QFont>
+#include <QImage>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/*!
+ * Debug layer that shows the performance of the overlay itself: a graph of the recent frame times, the mean stage
+ * times, the upload bandwidth, skipped and coalesced frames, the frame pacing, the overlay's memory and the
+ * statistics of all hector_timeit ConcurrentTimers.
+ *
+ * Every frame is recorded into a fixed-size history but the layer is only repainted at the refresh interval.
+ * The graph is kept in an image that is scrolled by the number of frames since the last repaint and only the new
+ * columns are drawn. Text statistics are over the frames since the last repaint.
+ * The timer and frame pacing statistics are sampled by sample() off the render thread, as merging a timer copies its
+ * histograms, and shown at the next repaint.
+ */
+class PerformanceHudLayer : public OverlayLayer {
+public:
+    explicit PerformanceHudLayer(const QRect &geometry,
+                                 std::chrono::milliseconds refresh_interval = std::chrono::milliseconds(250));
+
+    /*!
+     * Records a frame. Has to be called on the render thread, e.g., from the QOpenGLWrapper's frame callback.
+     */
+    void addFrame(const QOpenGLWrapper::FrameStatistics &stats);
+
+    /*!
+     * If disabled, the layer is cleared and frames are still recorded but nothing is painted. When enabled again, the
+     * statistics are shown from the next refresh on, over the frames since the layer was enabled.
+     */
+    void setEnabled(bool enabled);
+
+    //! Shows the jitter, stalls and content latency of the given analyzer which has to outlive the layer.
+    void setFramePacing(const FramePacingAnalyzer *frame_pacing);
+
+    /*!
+     * Takes the statistics of the ConcurrentTimers since the previous sample and the frame pacing. May be called on
+     * any thread but only one at a time, e.g., from a ROS timer at the refresh interval. Does nothing while the layer
+     * is disabled.
+     */
+    void sample();
+
+    std::chrono::steady_clock::duration refreshInterval() const { return refresh_interval_; }
+
+    bool isDirty() const override;
+
+    void paint(QPainter &painter) override;
+
+private:
+    //! Scrolls the graph by the frames recorded since the last repaint and draws their columns.
+    void updateGraph();
+
+    //! Starts a new window of the frame statistics at now.
+    void resetWindow(std::chrono::steady_clock::time_point now);
+
+    QFont font_;
+    int line_height_;
+    std::chrono::steady_clock::duration refresh_interval_;
+    std::chrono::steady_clock::time_point next_paint_;
+    std::chrono::steady_clock::time_point window_start_;
+    std::atomic<bool> enabled_{true};
+    std::atomic<bool> enabled_changed_{true};
+    //! Whether the last repaint was while enabled, i.e., the window started while the layer was shown.
+    bool shown_ = false;
+
+    QImage graph_;
+    //! Ring of the frame times of the last graph_.width() frames in nanoseconds.
+    std::vector<long> history_;
+    uint64_t recorded_ = 0;
+    uint64_t drawn_ = 0;
+
+    //! Accumulated since the last repaint.
+    struct Window {
+        uint64_t frames = 0;
+        long max_frame_time = 0;
+        long long frame_time = 0;
+        long long paint_time = 0;
+        long long readback_time = 0;
+        long long upload_time = 0;
+        uint64_t uploaded_bytes = 0;
+        uint64_t allocations = 0;
+        uint64_t allocated_bytes = 0;
+        uint64_t skipped_frames = 0;
+        uint64_t coalesced_updates = 0;
+    } window_;
+    QOpenGLWrapper::FrameStatistics last_;
+    std::atomic<const FramePacingAnalyzer *> frame_pacing_{nullptr};
+    MemoryAccount memory_{"performance_hud"};
+
+    //! Lines prepared by sample() for the next repaint.
+    struct Sample {
+        std::vector<QString> pacing_lines;
+        std::vector<QString> timer_lines;
+    };
+    std::mutex sample_mutex_;
+    Sample sample_;
+    //! Shown until a new sample was taken. Swapped with sample_, so the render thread does not allocate for it.
+    Sample shown_sample_;
+    bool sample_taken_ = false;
+    //! Timer statistics at the previous sample by timer id. Only used by sample().
+    std::unordered_map<size_t, hector_timeit::RunStatistics> previous_timer_stats_;
+    bool sampling_ = false;
+};
+
+#endif //PERFORMANCE_HUD_LAYER_HPP
@@ -0,0 +1,184 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#include "point_cloud_layer.hpp"
+#include "profile.hpp"
+
+#include <sensor_msgs/msg/point_field.hpp>
+
+#include <GL/gl.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+//! Number of points in a cell at which the density colour saturates.
+constexpr uint32_t DENSITY_SATURATION = 256;
+constexpr float MIN_HEIGHT = -1.f;
+constexpr float MAX_HEIGHT = 3.f;
+
+struct FieldOffsets {
+    uint32_t x, y, z;
+};
+
+//! Finds the float x, y and z fields. Fails if one is missing or does not lie within a point.
+bool findFields(const sensor_msgs::msg::PointCloud2 &cloud, FieldOffsets &offsets) {
+    int found = 0;
+    for (const auto &field : cloud.fields) {
+        if (field.datatype != sensor_msgs::msg::PointField::FLOAT32) continue;
+        if (field.name == "x") offsets.x = field.offset, found |= 1;
+        else if (field.name == "y") offsets.y = field.offset, found |= 2;
+        else if (field.name == "z") offsets.z = field.offset, found |= 4;
+    }
+    const auto within_point = [&cloud](uint32_t offset) { return size_t(offset) + sizeof(float) <= cloud.point_step; };
+    return found == 7 && within_point(offsets.x) && within_point(offsets.y) && within_point(offsets.z);
+}
+
+inline float readFloat(const uint8_t *data) {
+    float value;
+    std::memcpy(&value, data, sizeof(float));
+    return value;
+}
+}
+
+PointCloudLayer::PointCloudLayer(const QRect &geometry, float range, Mode mode, unsigned threads)
+        : OverlayLayer(geometry, Texture), range_(range), mode_(mode), pool_(threads) {
+    const size_t cells = size_t(geometry.width()) * geometry.height();
+    histograms_.resize(pool_.size());
+    for (auto &histogram : histograms_) {
+        histogram.count.resize(cells);
+        histogram.max_z.resize(cells);
+    }
+    back_buffer_.resize(4 * cells);
+    front_buffer_.resize(4 * cells);
+    // All buffers are allocated once
+    size_t bytes = back_buffer_.capacity() + front_buffer_.capacity();
+    for (const auto &histogram : histograms_) {
+        bytes += histogram.count.capacity() * sizeof(uint32_t) + histogram.max_z.capacity() * sizeof(float);
+    }
+    memory_.set(MemoryAccount::Image, bytes);
+    thread_ = std::thread(&PointCloudLayer::processLoop, this);
+}
+
+PointCloudLayer::~PointCloudLayer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    condition_.notify_one();
+    thread_.join();
+}
+
+void PointCloudLayer::setCloud(sensor_msgs::msg::PointCloud2::ConstSharedPtr cloud) {
+    // The latency includes the binning on the worker thread
+    markContentArrived();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_cloud_ = std::move(cloud);
+    }
+    condition_.notify_one();
+}
+
+bool PointCloudLayer::isDirty() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dirty_;
+}
+
+size_t PointCloudLayer::upload() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!dirty_) return 0;
+    const QRect &geometry = this->geometry();
+    glTexSubImage2D(GL_TEXTURE_2D, 0, geometry.x(), geometry.y(), geometry.width(), geometry.height(), GL_RGBA,
+                    GL_UNSIGNED_BYTE, front_buffer_.data());
+    dirty_ = false;
+    return front_buffer_.size();
+}
+
+void PointCloudLayer::processLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        condition_.wait(lock, [this] { return stop_ || pending_cloud_ != nullptr; });
+        if (stop_) return;
+        sensor_msgs::msg::PointCloud2::ConstSharedPtr cloud = std::move(pending_cloud_);
+        pending_cloud_ = nullptr;
+        lock.unlock();
+        const bool processed = process(*cloud);
+        lock.lock();
+        if (!processed) continue;
+        front_buffer_.swap(back_buffer_);
+        dirty_ = true;
+    }
+}
+
+bool PointCloudLayer::process(const sensor_msgs::msg::PointCloud2 &cloud) {
+    HECTOR_PROFILE_SCOPE_CONCURRENT("point_cloud_binning");
+    const size_t points = size_t(cloud.width) * cloud.height;
+    // The sizes come from the network, every point has to lie within its row and every row within the data
+    if (cloud.point_step < 3 * sizeof(float) || cloud.row_step < size_t(cloud.width) * cloud.point_step ||
+        cloud.data.size() < size_t(cloud.row_step) * cloud.height) {
+        return false;
+    }
+    FieldOffsets offsets{};
+    if (!findFields(cloud, offsets)) return false;
+
+    pool_.run([&](unsigned index, unsigned count) {
+        Histogram &histogram = histograms_[index];
+        std::fill(histogram.count.begin(), histogram.count.end(), 0);
+        std::fill(histogram.max_z.begin(), histogram.max_z.end(), -std::numeric_limits<float>::infinity());
+        const size_t begin = points * index / count, end = points * (index + 1) / count;
+        const bool packed = cloud.row_step == size_t(cloud.width) * cloud.point_step;
+        const int width = geometry().width(), height = geometry().height();
+        const float scale_x = width / (2 * range_), scale_y = height / (2 * range_);
+        for (size_t i = begin; i < end; ++i) {
+            const uint8_t *point = packed ? cloud.data.data() + i * cloud.point_step
+                                          : cloud.data.data() + (i / cloud.width) * cloud.row_step +
+                                            (i % cloud.width) * cloud.point_step;
+            // Written such that NaN fails the range checks
+            const float col = (range_ - readFloat(point + offsets.y)) * scale_x;
+            const float row = (range_ - readFloat(point + offsets.x)) * scale_y;
+            if (!(col >= 0 && col < width && row >= 0 && row < height)) continue;
+            const size_t cell = size_t(row) * width + size_t(col);
+            ++histogram.count[cell];
+            histogram.max_z[cell] = std::max(histogram.max_z[cell], readFloat(point + offsets.z));
+        }
+    });
+    const int height = geometry().height();
+    pool_.run([&](unsigned index, unsigned count) {
+        merge(height * index / count, height * (index + 1) / count);
+    });
+    return true;
+}
+
+void PointCloudLayer::merge(int row_begin, int row_end) {
+    const size_t width = geometry().width();
+    for (size_t cell = row_begin * width; cell < row_end * width; ++cell) {
+        uint32_t count = 0;
+        float max_z = -std::numeric_limits<float>::infinity();
+        for (const auto &histogram : histograms_) {
+            count += histogram.count[cell];
+            max_z = std::max(max_z, histogram.max_z[cell]);
+        }
+        uint8_t *pixel = back_buffer_.data() + 4 * cell;
+        if (count == 0) {
+            std::memset(pixel, 0, 4);
+            continue;
+        }
+        if (mode_ == Density) {
+            const float t = std::log2(1.f + std::min(count, DENSITY_SATURATION)) / std::log2(1.f + DENSITY_SATURATION);
+            pixel[0] = 255;
+            pixel[1] = static_cast<uint8_t>(255 * t);
+            pixel[2] = 0;
+            pixel[3] = static_cast<uint8_t>(128 + 127 * t);
+        } else {
+            float t = (max_z - MIN_HEIGHT) / (MAX_HEIGHT - MIN_HEIGHT);
+            t = std::isfinite(t) ? std::min(1.f, std::max(0.f, t)) : 0.f;
+            pixel[0] = static_cast<uint8_t>(255 * t);
+            pixel[1] = static_cast<uint8_t>(255 * (1 - std::abs(2 * t - 1)));
+            pixel[2] = static_cast<uint8_t>(255 * (1 - t));
+            pixel[3] = 220;
+        }
+    }
+}
@@ -0,0 +1,80 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#ifndef POINT_CLOUD_LAYER_HPP
+#define POINT_CLOUD_LAYER_HPP
+
+#include "memory_account.hpp"
+#include "overlay_layer.hpp"
+#include "worker_pool.hpp"
+
+#include <sensor_msgs/msg/point_cloud2.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*!
+ * Top-down view of a point cloud showing either the number of points or the highest point per cell.
+ * The x axis of the cloud's frame points up in the image and the y axis to the left.
+ *
+ * Clouds are processed on a separate thread: points are binned in parallel into per-thread histograms which are
+ * then merged and coloured in parallel by rows. If clouds arrive faster than they can be processed, only the
+ * newest is processed. The render thread only uploads the finished image.
+ */
+class PointCloudLayer : public OverlayLayer {
+public:
+    enum Mode { Density, Height };
+
+    /*!
+     * @param range Distance from the origin of the cloud's frame to the border of the image in meters.
+     * @param threads Number of threads used for binning. If 0, the number of hardware threads is used.
+     */
+    PointCloudLayer(const QRect &geometry, float range, Mode mode = Density, unsigned threads = 0);
+
+    ~PointCloudLayer() override;
+
+    /*!
+     * Queues a cloud for processing. Replaces a queued cloud that was not processed yet.
+     */
+    void setCloud(sensor_msgs::msg::PointCloud2::ConstSharedPtr cloud);
+
+    bool isDirty() const override;
+
+    size_t upload() override;
+
+private:
+    struct Histogram {
+        std::vector<uint32_t> count;
+        std::vector<float> max_z;
+    };
+
+    void processLoop();
+
+    //! @return False if the cloud has no float x, y and z fields or is malformed.
+    bool process(const sensor_msgs::msg::PointCloud2 &cloud);
+
+    void merge(int row_begin, int row_end);
+
+    const float range_;
+    const Mode mode_;
+    WorkerPool pool_;
+    std::vector<Histogram> histograms_;
+    //! Image that is written by the processing thread.
+    std::vector<uint8_t> back_buffer_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable condition_;
+    sensor_msgs::msg::PointCloud2::ConstSharedPtr pending_cloud_;
+    //! Image that is uploaded, guarded by mutex_.
+    std::vector<uint8_t> front_buffer_;
+    bool dirty_ = false;
+    bool stop_ = false;
+    MemoryAccount memory_{"point_cloud"};
+    std::thread thread_;
+};
+
+#endif //POINT_CLOUD_LAYER_HPP
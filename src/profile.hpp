@@ -0,0 +1,70 @@
+// Copyright (c) 2023 Stefan Fabian. All rights reserved.
+// Licensed under the MIT license.
+
+#ifndef HECTOR_TIMEIT_PROFILE_HPP
+#define HECTOR_TIMEIT_PROFILE_HPP
+
+/*
+ * Profiling macros that compile to nothing unless HECTOR_TIMEIT_PROFILING is defined, e.g., using the CMake option
+ * OVERLAY_TEST_ENABLE_PROFILING. If enabled, they use the cheapest available implementation: the TscClock policy
+ * with a single counter read at the start and end, and Streaming statistics which use fixed memory.
+ *
+ * HECTOR_PROFILE_SCOPE( name )
+ *   Measures the rest of the enclosing scope on a timer per call site that prints its statistics at exit.
+ *   The call site must not be executed by multiple threads at the same time.
+ * HECTOR_PROFILE_SCOPE_CONCURRENT( name )
+ *   Same as HECTOR_PROFILE_SCOPE but uses a ConcurrentTimer, hence, the call site may be executed concurrently.
+ * HECTOR_PROFILE_ZONE( variable, name )
+ *   Opens a ZoneBlock with the given variable name that can be closed before the end of the scope using
+ *   HECTOR_PROFILE_ZONE_END( variable ).
+ * HECTOR_PROFILE_ZONE_REPORT()
+ *   Prints the report of the ZoneProfiler at exit. Should be used once, e.g., in the outermost zone.
+ */
+
+#define HECTOR_TIMEIT_CONCAT_INNER( a, b ) a##b
+#define HECTOR_TIMEIT_CONCAT( a, b ) HECTOR_TIMEIT_CONCAT_INNER( a, b )
+
+#ifdef HECTOR_TIMEIT_PROFILING
+
+#include "concurrent_timer.hpp"
+#include "profile_zones.hpp"
+
+namespace hector_timeit
+{
+//! Timer used by the profiling macros. Use with Streaming statistics to avoid storing every run.
+using ProfileTimer = BasicTimer<TscClock>;
+} // namespace hector_timeit
+
+// The id makes the names of the variables unique if multiple macros are used on the same line
+#define HECTOR_PROFILE_SCOPE( name ) HECTOR_PROFILE_SCOPE_IMPL( name, __COUNTER__ )
+#define HECTOR_PROFILE_SCOPE_IMPL( name, id )                                                                          \
+  static hector_timeit::ProfileTimer HECTOR_TIMEIT_CONCAT( hector_profile_timer_, id )(                               \
+      name, hector_timeit::TimerBase::Default, false, true, hector_timeit::TimerBase::Streaming );                     \
+  hector_timeit::TimeBlock<hector_timeit::TscClock> HECTOR_TIMEIT_CONCAT( hector_profile_block_, id )(                 \
+      HECTOR_TIMEIT_CONCAT( hector_profile_timer_, id ) )
+
+#define HECTOR_PROFILE_SCOPE_CONCURRENT( name ) HECTOR_PROFILE_SCOPE_CONCURRENT_IMPL( name, __COUNTER__ )
+#define HECTOR_PROFILE_SCOPE_CONCURRENT_IMPL( name, id )                                                               \
+  static hector_timeit::ConcurrentTimer HECTOR_TIMEIT_CONCAT( hector_profile_timer_, id )(                            \
+      name, hector_timeit::TimerBase::Default, true );                                                                 \
+  hector_timeit::ConcurrentTimeBlock HECTOR_TIMEIT_CONCAT( hector_profile_block_, id )(                                \
+      HECTOR_TIMEIT_CONCAT( hector_profile_timer_, id ) )
+
+#define HECTOR_PROFILE_ZONE( variable, name ) hector_timeit::ZoneBlock<hector_timeit::TscClock> variable( name )
+
+#define HECTOR_PROFILE_ZONE_END( variable ) variable.end()
+
+#define HECTOR_PROFILE_ZONE_REPORT()                                                                                   \
+  static hector_timeit::ZoneReportPrinter HECTOR_TIMEIT_CONCAT( hector_profile_zone_report_, __COUNTER__ )
+
+#else
+
+#define HECTOR_PROFILE_SCOPE( name ) static_cast<void>( 0 )
+#define HECTOR_PROFILE_SCOPE_CONCURRENT( name ) static_cast<void>( 0 )
+#define HECTOR_PROFILE_ZONE( variable, name ) static_cast<void>( 0 )
+#define HECTOR_PROFILE_ZONE_END( variable ) static_cast<void>( 0 )
+#define HECTOR_PROFILE_ZONE_REPORT() static_cast<void>( 0 )
+
+#endif
+
+#endif // HECTOR_TIMEIT_PROFILE_HPP
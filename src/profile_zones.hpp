@@ -0,0 +1,269 @@
+// Copyright (c) 2023 Stefan Fabian. All rights reserved.
+// Licensed under the MIT license.
+
+#ifndef HECTOR_TIMEIT_PROFILE_ZONES_HPP
+#define HECTOR_TIMEIT_PROFILE_ZONES_HPP
+
+#include "timer.hpp"
+
+#include <iomanip>
+#include <mutex>
+
+namespace hector_timeit
+{
+
+/*!
+ * Collects nested ZoneBlocks into a call tree per thread.
+ * A frame ends whenever the outermost zone of a thread ends. The times of all calls of a zone within a frame are summed
+ * and added to the zone's statistics once per frame, both in total and excluding the time spent in child zones (self).
+ *
+ * Each thread only writes its own tree. The tree is locked when a zone is entered for the first time and at the end
+ * of a frame, not for every zone.
+ */
+class ZoneProfiler
+{
+public:
+  /*!
+   * Enters a zone as a child of the zone the calling thread currently is in.
+   * Prefer using ZoneBlock over calling enter and exit directly.
+   * @return The name interned by the TraceRecorder when the zone was entered for the first time.
+   */
+  static const char *enter( const char *name );
+
+  //! Exits the current zone of the calling thread which took the given time in nanoseconds.
+  static void exit( long elapsed );
+
+  /*!
+   * Formats the call trees of all threads with calls per frame and the total and self time per frame.
+   */
+  static std::string toString( TimerBase::TimeUnit print_time_unit = TimerBase::Default );
+
+private:
+  friend struct ZoneReportPrinter;
+
+  struct Node {
+    Node( std::string name, Node *parent )
+        : name( std::move( name ) ), trace_name( TraceRecorder::intern( this->name ) ), parent( parent ) { }
+
+    std::string name;
+    const char *trace_name;
+    Node *parent;
+    std::vector<std::unique_ptr<Node>> children;
+    // Accumulated in the current frame, only accessed by the owning thread
+    long frame_total = 0;
+    long frame_children = 0;
+    uint64_t frame_calls = 0;
+    // Aggregated over frames, guarded by the tree's mutex
+    RunStatistics total;
+    RunStatistics self;
+    uint64_t calls = 0;
+  };
+
+  struct ThreadTree {
+    explicit ThreadTree( size_t index ) : index( index ) { }
+
+    std::mutex mutex;
+    Node root{ "", nullptr };
+    Node *current = &root;
+    size_t index;
+    uint64_t frames = 0;
+  };
+
+  struct Registry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadTree>> trees;
+  };
+
+  static Registry &registry()
+  {
+    static Registry registry;
+    return registry;
+  }
+
+  static ThreadTree &localTree()
+  {
+    thread_local std::shared_ptr<ThreadTree> tree = [] {
+      Registry &registry = ZoneProfiler::registry();
+      std::lock_guard<std::mutex> lock( registry.mutex );
+      registry.trees.push_back( std::make_shared<ThreadTree>( registry.trees.size() ) );
+      return registry.trees.back();
+    }();
+    return *tree;
+  }
+
+  static void endFrame( ThreadTree &tree );
+
+  static void aggregate( Node &node );
+
+  static void print( std::ostringstream &stream, const Node &node, uint64_t frames, int depth,
+                     TimerBase::TimeUnit print_time_unit );
+};
+
+/*!
+ * @brief Measures a zone from construction until destruction or end().
+ * Zones opened while another zone of the same thread is open become its children in the ZoneProfiler's call tree.
+ * If constructed with a timer, the timer is used to measure the zone and records the run like a TimeBlock.
+ * Otherwise, the zone is measured with a single read of the Clock at the start and the end.
+ * Recorded by the TraceRecorder like a TimeBlock.
+ */
+template<typename Clock = ChronoClock>
+class ZoneBlock
+{
+public:
+  //! @param name The name of the zone.
+  explicit ZoneBlock( const char *name ) : name_( ZoneProfiler::enter( name ) ), traced_( TraceRecorder::isEnabled() )
+  {
+    if ( traced_ )
+      TraceRecorder::begin( name_ );
+    start_ = Clock::now();
+  }
+
+  explicit ZoneBlock( BasicTimer<Clock> &timer )
+      : timer_( &timer ), name_( timer.traceName() ), traced_( TraceRecorder::isEnabled() )
+  {
+    ZoneProfiler::enter( name_ );
+    if ( traced_ )
+      TraceRecorder::begin( name_ );
+    timer.start();
+  }
+
+  ~ZoneBlock() { end(); }
+
+  ZoneBlock( const ZoneBlock & ) = delete;
+  ZoneBlock &operator=( const ZoneBlock & ) = delete;
+
+  void end()
+  {
+    if ( ended_ )
+      return;
+    ended_ = true;
+    long elapsed;
+    if ( timer_ != nullptr ) {
+      timer_->stop();
+      elapsed = timer_->getElapsedTime();
+      timer_->reset( true );
+    } else {
+      elapsed = Clock::toNanoseconds( start_, Clock::now() );
+    }
+    if ( traced_ )
+      TraceRecorder::end( name_ );
+    ZoneProfiler::exit( elapsed );
+  }
+
+private:
+  BasicTimer<Clock> *timer_ = nullptr;
+  const char *name_;
+  bool traced_;
+  typename Clock::time_point start_{};
+  bool ended_ = false;
+};
+
+/*!
+ * Prints the ZoneProfiler's report when destroyed, e.g., when used as a function-local static.
+ */
+struct ZoneReportPrinter {
+  explicit ZoneReportPrinter( TimerBase::TimeUnit print_time_unit = TimerBase::Default )
+      : print_time_unit_( print_time_unit )
+  {
+    // Make sure the registry outlives this printer
+    ZoneProfiler::registry();
+  }
+
+  ~ZoneReportPrinter() { std::cout << ZoneProfiler::toString( print_time_unit_ ) << std::endl << std::flush; }
+
+  TimerBase::TimeUnit print_time_unit_;
+};
+
+inline const char *ZoneProfiler::enter( const char *name )
+{
+  ThreadTree &tree = localTree();
+  Node *parent = tree.current;
+  for ( const auto &child : parent->children ) {
+    if ( child->name == name ) {
+      tree.current = child.get();
+      return child->trace_name;
+    }
+  }
+  std::lock_guard<std::mutex> lock( tree.mutex );
+  parent->children.push_back( std::make_unique<Node>( name, parent ) );
+  tree.current = parent->children.back().get();
+  return tree.current->trace_name;
+}
+
+inline void ZoneProfiler::exit( long elapsed )
+{
+  ThreadTree &tree = localTree();
+  Node *node = tree.current;
+  if ( node == &tree.root )
+    return; // Unbalanced exit
+  node->frame_total += elapsed;
+  ++node->frame_calls;
+  tree.current = node->parent;
+  tree.current->frame_children += elapsed;
+  if ( tree.current == &tree.root )
+    endFrame( tree );
+}
+
+inline void ZoneProfiler::endFrame( ThreadTree &tree )
+{
+  std::lock_guard<std::mutex> lock( tree.mutex );
+  aggregate( tree.root );
+  tree.root.frame_children = 0;
+  ++tree.frames;
+}
+
+inline void ZoneProfiler::aggregate( Node &node )
+{
+  for ( const auto &child : node.children ) {
+    if ( child->frame_calls == 0 )
+      continue;
+    aggregate( *child );
+    child->total.add( child->frame_total );
+    child->self.add( child->frame_total - child->frame_children );
+    child->calls += child->frame_calls;
+    child->frame_total = 0;
+    child->frame_children = 0;
+    child->frame_calls = 0;
+  }
+}
+
+inline std::string ZoneProfiler::toString( TimerBase::TimeUnit print_time_unit )
+{
+  std::ostringstream stream;
+  Registry &registry = ZoneProfiler::registry();
+  std::lock_guard<std::mutex> registry_lock( registry.mutex );
+  for ( const auto &tree : registry.trees ) {
+    std::lock_guard<std::mutex> lock( tree->mutex );
+    if ( tree->frames == 0 )
+      continue;
+    stream << "[Zones: thread " << tree->index << "] " << tree->frames << " frame(s)" << std::endl;
+    stream << std::left << std::setw( 32 ) << "Zone" << std::right;
+    for ( const char *column : { "Calls/frame", "Total", "Total p99", "Self", "Self p99" } )
+      printPaddedString( stream, column, 14 );
+    stream << std::endl;
+    for ( const auto &child : tree->root.children ) print( stream, *child, tree->frames, 0, print_time_unit );
+  }
+  return stream.str();
+}
+
+inline void ZoneProfiler::print( std::ostringstream &stream, const Node &node, uint64_t frames, int depth,
+                                 TimerBase::TimeUnit print_time_unit )
+{
+  stream << std::left << std::setw( 32 ) << ( std::string( 2 * depth, ' ' ) + node.name ) << std::right;
+  std::ostringstream calls;
+  calls.precision( 2 );
+  calls.setf( std::ios::fixed, std::ios::floatfield );
+  calls << static_cast<double>( node.calls ) / frames;
+  printPaddedString( stream, calls.str(), 14 );
+  // Means are over the frames the zone was part of
+  printTimeString( stream, node.total.mean(), print_time_unit, 14 );
+  printTimeString( stream, node.total.percentile( 99 ), print_time_unit, 14 );
+  printTimeString( stream, node.self.mean(), print_time_unit, 14 );
+  printTimeString( stream, node.self.percentile( 99 ), print_time_unit, 14 );
+  stream << std::endl;
+  for ( const auto &child : node.children ) print( stream, *child, frames, depth + 1, print_time_unit );
+}
+
+} // namespace hector_timeit
+
+#endif // HECTOR_TIMEIT_PROFILE_ZONES_HPP
@@ -3,7 +3,11 @@
 //
 
 #include "qopengl_wrapper.hpp"
-#include "timer.hpp"
+#include "overlay_layer.hpp"
+#include "allocation_tracker.hpp"
+#include "concurrent_timer.hpp"
+#include "native_gl_context.hpp"
+#include "profile.hpp"
 
 #include <QPainter>
 #include <QOpenGLContext>
@@ -11,34 +15,220 @@
 #include <QOpenGLPaintDevice>
 #include <QOffscreenSurface>
 
-#include <GL/glx.h>
+#include <GL/gl.h>
 
+#include <algorithm>
+#include <chrono>
 
-QOpenGLWrapper::QOpenGLWrapper(int width, int height, unsigned int texture_id) : width_(width), height_(height), texture_id_(texture_id) {
+
+namespace {
+enum QtGpuStage {
+    GpuPaint,
+    GpuReadback
+};
+
+enum OgreGpuStage {
+    GpuUpload,
+    GpuComposite
+};
+
+std::vector<hector_timeit::ConcurrentTimer *> qtGpuStageTimers() {
+    static hector_timeit::ConcurrentTimer paint("gpu_paint", hector_timeit::Timer::Default, true);
+    static hector_timeit::ConcurrentTimer readback("gpu_readback", hector_timeit::Timer::Default, true);
+    return {&paint, &readback};
+}
+
+std::vector<hector_timeit::ConcurrentTimer *> ogreGpuStageTimers() {
+    static hector_timeit::ConcurrentTimer upload("gpu_upload", hector_timeit::Timer::Default, true);
+    static hector_timeit::ConcurrentTimer composite("gpu_composite", hector_timeit::Timer::Default, true);
+    return {&upload, &composite};
+}
+
+//! Wall times of draw and its stages. Always recorded, unlike the profiling scopes, to be published on /diagnostics.
+struct StageTimers {
+    hector_timeit::ConcurrentTimer frame{"cpu_frame"};
+    hector_timeit::ConcurrentTimer paint{"cpu_paint"};
+    hector_timeit::ConcurrentTimer readback{"cpu_readback"};
+    hector_timeit::ConcurrentTimer upload{"cpu_upload"};
+};
+
+StageTimers &stageTimers() {
+    static StageTimers timers;
+    return timers;
+}
+}
+
+QOpenGLWrapper::QOpenGLWrapper(int width, int height, unsigned int texture_id)
+        : memory_("overlay"), qt_gpu_timer_(qtGpuStageTimers()), ogre_gpu_timer_(ogreGpuStageTimers()),
+          width_(width), height_(height), texture_id_(texture_id) {
+    // RGBA8 without mipmaps, see createOgreOverlay
+    memory_.set(MemoryAccount::Texture, 4 * size_t(width) * height);
+}
+
+QOpenGLWrapper::~QOpenGLWrapper() {
+    const NativeGLContext native_context = NativeGLContext::current();
+    if (native_context.api() != NativeGLContext::None) ogre_gpu_timer_.release();
+    if (context_ == nullptr) return;
+    // The painter, paint device and FBO release their GL resources in the Qt context
+    context_->makeCurrent(surface_);
+    qt_gpu_timer_.release();
+    delete painter_;
+    delete paint_device_;
+    delete fbo_;
+    context_->doneCurrent();
+    native_context.makeCurrent();
+    delete context_;
+    delete surface_;
 }
 
 void QOpenGLWrapper::draw() {
     init();
-    static hector_timeit::Timer timer("render", hector_timeit::Timer::Default, false, true);
-    hector_timeit::TimeBlock block(timer);
-    GLXContext native_context = glXGetCurrentContext();
-    GLXDrawable native_drawable = glXGetCurrentDrawable();
-    ::Display *display = glXGetCurrentDisplay();
+    HECTOR_PROFILE_SCOPE_CONCURRENT("render");
+    HECTOR_PROFILE_ZONE_REPORT();
+    HECTOR_PROFILE_ZONE(render_zone, "render");
+    const auto frame_start = std::chrono::steady_clock::now();
+    const hector_timeit::AllocationScope allocation_scope;
+    FrameStatistics &stats = frame_statistics_;
+    ++stats.frames;
+    stats.uploaded_bytes = 0;
+    stats.updated_layers = 0;
+    for (const auto &layer : layers_) layer->poll();
+    const NativeGLContext native_context = NativeGLContext::current();
     context_->makeCurrent(surface_);
     if (paint_device_ == nullptr) {
         paint_device_ = new QOpenGLPaintDevice(width_, height_);
         fbo_ = new QOpenGLFramebufferObject(width_, height_);
+        // A single RGBA8 color attachment
+        memory_.set(MemoryAccount::Framebuffer, 4 * size_t(width_) * height_);
     painter_ = new QPainter(paint_device_);
     }
+    auto record_arrival = [this](OverlayLayer &layer) {
+        const auto arrival = layer.takeContentArrival();
+        if (arrival.time_since_epoch().count() != 0) frame_pacing_.recordContentUpdate(arrival);
+    };
     fbo_->bind();
-    painter_->fillRect( width_ / 4, height_ / 4, width_ / 2, height_ / 2, Qt::blue );
+    HECTOR_PROFILE_ZONE(paint_zone, "paint");
+    qt_gpu_timer_.begin(GpuPaint);
+    dirty_rects_.clear();
+    unsigned painted_layers = 0;
+    stats.paint_allocations = 0;
+    for (const auto &layer : layers_) {
+        if (layer->target() != OverlayLayer::Painter || !layer->isDirty()) continue;
+        record_arrival(*layer);
+        const QRect &geometry = layer->geometry();
+        const hector_timeit::AllocationScope paint_allocation_scope;
+        painter_->setCompositionMode(QPainter::CompositionMode_Source);
+        painter_->fillRect(geometry, Qt::transparent);
+        painter_->setCompositionMode(QPainter::CompositionMode_SourceOver);
+        painter_->save();
+        painter_->translate(geometry.topLeft());
+        painter_->setClipRect(0, 0, geometry.width(), geometry.height());
+        layer->paint(*painter_);
+        painter_->restore();
+        stats.paint_allocations += paint_allocation_scope.counts().allocations;
+        addDirtyRect(geometry & QRect(0, 0, width_, height_));
+        ++painted_layers;
+    }
+    stats.updated_layers += painted_layers;
+    // Painted layers whose rectangles were merged share a readback and upload
+    stats.coalesced_updates += painted_layers - dirty_rects_.size();
+    qt_gpu_timer_.end(GpuPaint);
+    HECTOR_PROFILE_ZONE_END(paint_zone);
+    const auto paint_end = std::chrono::steady_clock::now();
+    HECTOR_PROFILE_ZONE(readback_zone, "readback");
+    qt_gpu_timer_.begin(GpuReadback);
+    if (!dirty_rects_.empty()) {
+        // Only read back the regions that changed, one after another into the readback buffer. The framebuffer's
+        // origin is bottom left, hence, the rows are flipped after reading.
+        size_t size = 0;
+        for (const QRect &rect : dirty_rects_) size += 4 * size_t(rect.width()) * rect.height();
+        readback_.resize(size);
+        memory_.set(MemoryAccount::StagingBuffer, readback_.capacity());
+        painter_->beginNativePainting();
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        uint8_t *data = readback_.data();
+        for (const QRect &rect : dirty_rects_) {
+            glReadPixels(rect.x(), height_ - rect.y() - rect.height(), rect.width(), rect.height(), GL_RGBA,
+                         GL_UNSIGNED_BYTE, data);
+            const size_t row_size = 4 * rect.width();
+            for (int top = 0, bottom = rect.height() - 1; top < bottom; ++top, --bottom) {
+                std::swap_ranges(data + top * row_size, data + (top + 1) * row_size, data + bottom * row_size);
+            }
+            data += row_size * rect.height();
+        }
+        painter_->endNativePainting();
+    }
+    qt_gpu_timer_.end(GpuReadback);
+    HECTOR_PROFILE_ZONE_END(readback_zone);
+    const auto readback_end = std::chrono::steady_clock::now();
     fbo_->release();
     QOpenGLFramebufferObject::bindDefault();
-    QImage img = fbo_->toImage();
     context_->doneCurrent();
-    glXMakeCurrent(display, native_drawable, native_context);
+    native_context.makeCurrent();
+    HECTOR_PROFILE_ZONE(upload_zone, "upload");
+    ogre_gpu_timer_.begin(GpuUpload);
     glBindTexture(GL_TEXTURE_2D, texture_id_);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, img.bits());
+    const uint8_t *data = readback_.data();
+    for (const QRect &rect : dirty_rects_) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x(), rect.y(), rect.width(), rect.height(), GL_RGBA, GL_UNSIGNED_BYTE,
+                        data);
+        data += 4 * size_t(rect.width()) * rect.height();
+    }
+    if (!dirty_rects_.empty()) stats.uploaded_bytes += readback_.size();
+    for (const auto &layer : layers_) {
+        if (layer->target() != OverlayLayer::Texture || !layer->isDirty()) continue;
+        record_arrival(*layer);
+        stats.uploaded_bytes += layer->upload();
+        ++stats.updated_layers;
+    }
+    ogre_gpu_timer_.end(GpuUpload);
+    const auto frame_end = std::chrono::steady_clock::now();
+    if (stats.updated_layers == 0) ++stats.skipped_frames;
+    stats.paint_time = std::chrono::duration_cast<std::chrono::nanoseconds>(paint_end - frame_start).count();
+    stats.readback_time = std::chrono::duration_cast<std::chrono::nanoseconds>(readback_end - paint_end).count();
+    stats.upload_time = std::chrono::duration_cast<std::chrono::nanoseconds>(frame_end - readback_end).count();
+    stats.frame_time = std::chrono::duration_cast<std::chrono::nanoseconds>(frame_end - frame_start).count();
+    const hector_timeit::AllocationCounts allocations = allocation_scope.counts();
+    stats.allocations = allocations.allocations;
+    stats.allocated_bytes = allocations.allocated_bytes;
+    StageTimers &timers = stageTimers();
+    timers.frame.record(stats.frame_time, -1);
+    timers.paint.record(stats.paint_time, -1);
+    timers.readback.record(stats.readback_time, -1);
+    timers.upload.record(stats.upload_time, -1);
+    if (frame_callback_) frame_callback_(stats);
+}
+
+void QOpenGLWrapper::addLayer(std::shared_ptr<OverlayLayer> layer) {
+    layers_.push_back(std::move(layer));
+    dirty_rects_.reserve(layers_.size());
+}
+
+void QOpenGLWrapper::addDirtyRect(const QRect &rect) {
+    if (rect.isEmpty()) return;
+    for (QRect &dirty_rect : dirty_rects_) {
+        const QRect merged = dirty_rect | rect;
+        // The readback of the merged rectangle would overwrite texture layers in between with the FBO's pixels
+        const bool covers_texture_layer = std::any_of(layers_.begin(), layers_.end(), [&merged](const auto &layer) {
+            return layer->target() == OverlayLayer::Texture && merged.intersects(layer->geometry());
+        });
+        if (covers_texture_layer) continue;
+        dirty_rect = merged;
+        return;
+    }
+    dirty_rects_.push_back(rect);
+}
+
+void QOpenGLWrapper::setFrameCallback(std::function<void(const FrameStatistics &)> callback) {
+    frame_callback_ = std::move(callback);
+}
+
+void QOpenGLWrapper::beginComposite() {
+    ogre_gpu_timer_.begin(GpuComposite);
+}
+
+void QOpenGLWrapper::endComposite() {
+    ogre_gpu_timer_.end(GpuComposite);
 }
 
 void QOpenGLWrapper::init() {
@@ -4,7 +4,18 @@
 
 #ifndef QOPENGL_WRAPPER_HPP
 #define QOPENGL_WRAPPER_HPP
+#include "frame_pacing.hpp"
+#include "gpu_timer.hpp"
+#include "memory_account.hpp"
+
+#include <QRect>
+
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <vector>
+
+class OverlayLayer;
 
 class QPainter;
 class QOpenGLFramebufferObject;
@@ -14,17 +25,99 @@ class QOpenGLContext;
 
 class QOpenGLWrapper {
 public:
+    //! Timings and transferred data of a call to draw and counters over all calls.
+    struct FrameStatistics {
+        //! Wall times of the frame and its stages in nanoseconds.
+        long frame_time = 0;
+        long paint_time = 0;
+        long readback_time = 0;
+        long upload_time = 0;
+        //! Bytes uploaded to the overlay texture in this frame.
+        size_t uploaded_bytes = 0;
+        //! Number of layers that were painted or uploaded in this frame.
+        unsigned updated_layers = 0;
+        uint64_t frames = 0;
+        //! Frames in which no layer was dirty.
+        uint64_t skipped_frames = 0;
+        //! Painter layer updates that were transferred in the merged rectangle of another layer's update.
+        uint64_t coalesced_updates = 0;
+        //! Heap allocations of the render thread in this frame. Zero unless the hector_timeit allocation hooks are
+        //! installed, see hector_timeit::AllocationTracker.
+        uint64_t allocations = 0;
+        uint64_t allocated_bytes = 0;
+        //! The allocations made while painting the painter layers. QPainter allocates for its states, clips and
+        //! brushes, all other allocations of draw should stop once its buffers have grown to the frame's size.
+        uint64_t paint_allocations = 0;
+    };
+
     QOpenGLWrapper(int width, int height, unsigned int texture_id);
 
+    /*!
+     * Releases the Qt context and the resources drawn with. The GPU timer queries of the upload are created in the
+     * context that is current during draw, e.g., Ogre's, hence, they are only released if a context is current.
+     */
+    ~QOpenGLWrapper();
+
+    QOpenGLWrapper(const QOpenGLWrapper &) = delete;
+
+    QOpenGLWrapper &operator=(const QOpenGLWrapper &) = delete;
+
 void draw();
 
     void init();
+
+    /*!
+     * Adds a layer that is drawn into the overlay whenever it is dirty. Only the rectangles of the changed painter
+     * layers are read back and uploaded. Rectangles are merged into their bounding rectangle if that does not cover a
+     * texture layer, whose pixels would otherwise be overwritten with the framebuffer's.
+     */
+    void addLayer(std::shared_ptr<OverlayLayer> layer);
+
+    /*!
+     * Measure the GPU time of compositing the overlay into the scene. Have to be called with the Ogre context
+     * current, e.g., from a RenderQueueListener around the overlay render queue.
+     */
+    void beginComposite();
+
+    void endComposite();
+
+    /*!
+     * Sets a callback that is called on the render thread at the end of each draw, e.g., to collect a history.
+     */
+    void setFrameCallback(std::function<void(const FrameStatistics &)> callback);
+
+    /*!
+     * Frame pacing of the render target the overlay is shown on. Frames have to be recorded by the caller of draw,
+     * the arrivals of the content of the layers drawn by draw are recorded for the content latency.
+     */
+    FramePacingAnalyzer &framePacing() { return frame_pacing_; }
+
+    /*!
+     * The overlay texture, the framebuffer painted into and the readback buffer. The overlay texture is accounted
+     * here as it lives as long as the wrapper drawing into it. Layers account for their own resources.
+     */
+    const MemoryAccount &memory() const { return memory_; }
 private:
+    //! Adds a rectangle to transfer, merged with an earlier one if that does not cover a texture layer.
+    void addDirtyRect(const QRect &rect);
+
     QOpenGLContext *context_ = nullptr;
     QOffscreenSurface *surface_ = nullptr;
     QOpenGLFramebufferObject *fbo_ = nullptr;
     QOpenGLPaintDevice *paint_device_ = nullptr;
-    QPainter *painter_;
+    QPainter *painter_ = nullptr;
+    std::vector<std::shared_ptr<OverlayLayer>> layers_;
+    //! Rectangles of the painter layers painted in the current frame, read back and uploaded one by one.
+    std::vector<QRect> dirty_rects_;
+    std::vector<uint8_t> readback_;
+    FrameStatistics frame_statistics_;
+    std::function<void(const FrameStatistics &)> frame_callback_;
+    FramePacingAnalyzer frame_pacing_;
+    MemoryAccount memory_;
+    //! GPU stages measured in the Qt context.
+    GpuTimer qt_gpu_timer_;
+    //! GPU stages measured in the Ogre context.
+    GpuTimer ogre_gpu_timer_;
     int width_, height_;
     unsigned int texture_id_;
 };
@@ -26,3 +26,8 @@ void addRenderTargetListener(rviz_common::DisplayContext *context, Ogre::RenderT
     rviz_rendering::RenderWindow *render_window = getRenderWindow(context);
     rviz_rendering::RenderWindowOgreAdapter::addListener(render_window, listener);
 }
+
+void removeRenderTargetListener(rviz_common::DisplayContext *context, Ogre::RenderTargetListener *listener) {
+    rviz_rendering::RenderWindow *render_window = getRenderWindow(context);
+    rviz_rendering::RenderWindowOgreAdapter::removeListener(render_window, listener);
+}
@@ -23,6 +23,8 @@ void prepareOverlays(Ogre::SceneManager *scene_manager);
 
 void addRenderTargetListener(rviz_common::DisplayContext *context, Ogre::RenderTargetListener *listener);
 
+void removeRenderTargetListener(rviz_common::DisplayContext *context, Ogre::RenderTargetListener *listener);
+
 
 
 #endif //RVIZ_WRAPPER_H
@@ -0,0 +1,144 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#include "shared_memory_layer.hpp"
+#include "overlay_test/shared_frame.hpp"
+
+#include <GL/gl.h>
+
+#include <algorithm>
+
+using overlay_test::SharedFrameHeader;
+using overlay_test::SharedFrameSlot;
+
+namespace {
+constexpr std::chrono::seconds OPEN_RETRY_INTERVAL(1);
+}
+
+SharedMemoryLayer::SharedMemoryLayer(const QRect &geometry, std::string name)
+        : OverlayLayer(geometry, Texture), name_(std::move(name)) {
+}
+
+SharedMemoryLayer::~SharedMemoryLayer() {
+    close();
+}
+
+void SharedMemoryLayer::poll() {
+    const auto now = std::chrono::steady_clock::now();
+    if (header_ == nullptr) {
+        if (now >= next_open_attempt_) open();
+        return;
+    }
+    if (header_->latest.load(std::memory_order_acquire) != uploaded_ || now < next_replacement_check_) return;
+    // A producer that exits unlinks its object, a restarted producer creates a new one we would not see
+    next_replacement_check_ = now + OPEN_RETRY_INTERVAL;
+    if (isUnlinked()) {
+        close();
+        open();
+    }
+}
+
+bool SharedMemoryLayer::isDirty() const {
+    return header_ != nullptr && header_->latest.load(std::memory_order_acquire) != uploaded_;
+}
+
+size_t SharedMemoryLayer::upload() {
+    if (header_ == nullptr) return 0;
+    const uint64_t latest = header_->latest.load(std::memory_order_acquire);
+    if (latest == uploaded_ || latest == 0) return 0;
+    if (latest < uploaded_) uploaded_ = 0; // The producer restarted
+    const uint32_t frame_width = header_->width, frame_height = header_->height;
+    if (overlay_test::sharedFrameSize(frame_width, frame_height, header_->slot_count) > size_) {
+        // The producer recreated the frames with a different size
+        close();
+        return 0;
+    }
+
+    const uint64_t newest = latest - 1;
+    const SharedFrameSlot &slot = header_->slots[newest % header_->slot_count];
+    const uint64_t state = slot.state.load(std::memory_order_acquire);
+    if (state != 2 * newest + 2) return 0;
+    QRect rect = dirtyRect(newest) & QRect(0, 0, std::min<int>(frame_width, geometry().width()),
+                                           std::min<int>(frame_height, geometry().height()));
+    size_t bytes = 0;
+    if (!rect.isEmpty()) {
+        const uint8_t *pixels = reinterpret_cast<const uint8_t *>(header_) + overlay_test::sharedFramePixelOffset() +
+                                (newest % header_->slot_count) * overlay_test::sharedFrameBytes(frame_width, frame_height);
+        pixels += 4 * (size_t(rect.y()) * frame_width + rect.x());
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, frame_width);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, geometry().x() + rect.x(), geometry().y() + rect.y(), rect.width(),
+                        rect.height(), GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        bytes = 4 * size_t(rect.width()) * rect.height();
+    }
+    // glTexSubImage2D has consumed the client memory when it returns. If the producer started overwriting the slot
+    // in the meantime, the upload may be torn and is repeated with the next frame.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.state.load(std::memory_order_relaxed) != state) return bytes;
+    uploaded_ = latest;
+    return bytes;
+}
+
+QRect SharedMemoryLayer::dirtyRect(uint64_t newest) const {
+    const QRect full(0, 0, header_->width, header_->height);
+    if (uploaded_ == 0 || newest - uploaded_ >= header_->slot_count) return full;
+    QRect result;
+    for (uint64_t frame = uploaded_; frame <= newest; ++frame) {
+        const SharedFrameSlot &slot = header_->slots[frame % header_->slot_count];
+        const uint64_t state = slot.state.load(std::memory_order_acquire);
+        QRect rect(slot.dirty_x, slot.dirty_y, slot.dirty_width, slot.dirty_height);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // The slot was already reused for a newer frame, hence, we don't know what changed
+        if (state != 2 * frame + 2 || slot.state.load(std::memory_order_relaxed) != state) return full;
+        result |= rect;
+    }
+    return result;
+}
+
+bool SharedMemoryLayer::open() {
+    const auto now = std::chrono::steady_clock::now();
+    next_open_attempt_ = now + OPEN_RETRY_INTERVAL;
+    next_replacement_check_ = now + OPEN_RETRY_INTERVAL;
+    int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+    if (fd == -1) return false;
+    struct stat stats{};
+    if (fstat(fd, &stats) == -1 || size_t(stats.st_size) < sizeof(SharedFrameHeader)) {
+        ::close(fd);
+        return false;
+    }
+    void *memory = mmap(nullptr, stats.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+    // Kept open to detect that the object was unlinked
+    fd_ = fd;
+    header_ = static_cast<SharedFrameHeader *>(memory);
+    size_ = stats.st_size;
+    if (header_->magic.load(std::memory_order_acquire) != overlay_test::SHARED_FRAME_MAGIC ||
+        header_->version != overlay_test::SHARED_FRAME_VERSION || header_->slot_count < 2 ||
+        header_->slot_count > overlay_test::SHARED_FRAME_MAX_SLOTS ||
+        overlay_test::sharedFrameSize(header_->width, header_->height, header_->slot_count) > size_) {
+        close();
+        return false;
+    }
+    uploaded_ = 0;
+    memory_.set(MemoryAccount::SharedMemory, size_);
+    return true;
+}
+
+void SharedMemoryLayer::close() {
+    if (header_ == nullptr) return;
+    munmap(header_, size_);
+    ::close(fd_);
+    fd_ = -1;
+    header_ = nullptr;
+    size_ = 0;
+    memory_.set(MemoryAccount::SharedMemory, 0);
+}
+
+bool SharedMemoryLayer::isUnlinked() const {
+    struct stat stats{};
+    return fstat(fd_, &stats) == -1 || stats.st_nlink == 0;
+}
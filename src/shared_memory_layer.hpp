@@ -0,0 +1,61 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#ifndef SHARED_MEMORY_LAYER_HPP
+#define SHARED_MEMORY_LAYER_HPP
+
+#include "memory_account.hpp"
+#include "overlay_layer.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace overlay_test {
+struct SharedFrameHeader;
+}
+
+/*!
+ * Shows frames rendered by another process on the same machine.
+ * The frames are read from a POSIX shared memory ring (see overlay_test/shared_frame.hpp) and the changed region
+ * of the newest complete frame is uploaded straight from the mapping into the overlay texture.
+ * If the shared memory object does not exist yet, opening it is retried periodically. If it was unlinked, e.g.,
+ * because the producer exited, the mapping is dropped and the object of a restarted producer is opened instead.
+ */
+class SharedMemoryLayer : public OverlayLayer {
+public:
+    SharedMemoryLayer(const QRect &geometry, std::string name);
+
+    ~SharedMemoryLayer() override;
+
+    //! Opens the shared memory object if it is not mapped and drops the mapping if the object was unlinked.
+    void poll() override;
+
+    bool isDirty() const override;
+
+    size_t upload() override;
+
+private:
+    bool open();
+
+    void close();
+
+    //! @return True if the mapped object was unlinked, i.e., a restarted producer creates a new one.
+    bool isUnlinked() const;
+
+    //! @return The union of the dirty rectangles of the frames after uploaded_ up to newest or the full frame.
+    QRect dirtyRect(uint64_t newest) const;
+
+    std::string name_;
+    int fd_ = -1;
+    overlay_test::SharedFrameHeader *header_ = nullptr;
+    size_t size_ = 0;
+    //! Number of the last uploaded frame + 1, 0 if none was uploaded.
+    uint64_t uploaded_ = 0;
+    std::chrono::steady_clock::time_point next_open_attempt_;
+    std::chrono::steady_clock::time_point next_replacement_check_;
+    MemoryAccount memory_{"shared_memory"};
+};
+
+#endif //SHARED_MEMORY_LAYER_HPP
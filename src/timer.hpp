@@ -4,12 +4,29 @@
 #ifndef HECTOR_TIMEIT_TIMER_HPP
 #define HECTOR_TIMEIT_TIMER_HPP
 
-#include <cassert>
+#include "allocation_tracker.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
 #include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <random>
 #include <string>
+#include <thread>
+#include <unordered_set>
 #include <vector>
 
+#if ( defined( __x86_64__ ) || defined( __i386__ ) ) && defined( __GNUC__ )
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
 #ifdef __unix__
 
 #include <time.h>
@@ -17,19 +34,282 @@
 
 #endif
 
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
 namespace hector_timeit
 {
 
 /*!
- * Timer class that can be used for simple profiling.
- * The runtime of a single method can be measured using the static time method.
- * To measure multiple runs use a Timer instance and pass true to the reset method between runs.
+ * Histogram with logarithmically sized buckets similar to an HDR histogram.
+ * Each power of two is split into SubBucketCount linear buckets, hence, the relative error of a reported value is at
+ * most 1 / SubBucketCount (~3%) while the memory is fixed independent of the number of recorded values.
+ */
+class LogHistogram
+{
+public:
+  static constexpr int SubBucketBits = 5;
+  static constexpr int SubBucketCount = 1 << SubBucketBits;
+  //! Values are tracked up to 2^MaxExponent - 1 (~4.9h in nanoseconds), larger values are clamped.
+  static constexpr int MaxExponent = 44;
+  static constexpr int BucketCount = ( MaxExponent - SubBucketBits + 1 ) * SubBucketCount;
+
+  void add( long value, uint64_t count = 1 )
+  {
+    buckets_[bucketIndex( value )] += count;
+    count_ += count;
+  }
+
+  void merge( const LogHistogram &other )
+  {
+    for ( int i = 0; i < BucketCount; ++i ) buckets_[i] += other.buckets_[i];
+    count_ += other.count_;
+  }
+
+  //! Removes the values of an earlier state of this histogram, leaving the values added since.
+  void subtract( const LogHistogram &earlier )
+  {
+    for ( int i = 0; i < BucketCount; ++i ) buckets_[i] -= earlier.buckets_[i];
+    count_ -= earlier.count_;
+  }
+
+  void clear()
+  {
+    buckets_.fill( 0 );
+    count_ = 0;
+  }
+
+  uint64_t count() const { return count_; }
+
+  uint64_t bucket( int index ) const { return buckets_[index]; }
+
+  /*!
+   * @param percent The percentile in [0, 100], e.g., 99.9.
+   * @return The highest value that falls into the same bucket as the value at the given percentile or 0 if empty.
+   */
+  long percentile( double percent ) const
+  {
+    if ( count_ == 0 )
+      return 0;
+    auto rank = static_cast<uint64_t>( std::ceil( percent / 100.0 * count_ ) );
+    if ( rank < 1 )
+      rank = 1;
+    uint64_t seen = 0;
+    for ( int i = 0; i < BucketCount; ++i ) {
+      seen += buckets_[i];
+      if ( seen >= rank )
+        return bucketUpperBound( i );
+    }
+    return bucketUpperBound( BucketCount - 1 );
+  }
+
+  static int bucketIndex( long value )
+  {
+    if ( value < 0 )
+      value = 0;
+    auto v = static_cast<uint64_t>( value );
+    if ( v >= ( uint64_t( 1 ) << MaxExponent ) )
+      v = ( uint64_t( 1 ) << MaxExponent ) - 1;
+    if ( v < static_cast<uint64_t>( SubBucketCount ) )
+      return static_cast<int>( v );
+    int shift = highestBit( v ) - SubBucketBits;
+    return ( shift + 1 ) * SubBucketCount + static_cast<int>( ( v >> shift ) - SubBucketCount );
+  }
+
+  static long bucketLowerBound( int index )
+  {
+    if ( index < SubBucketCount )
+      return index;
+    int shift = index / SubBucketCount - 1;
+    return static_cast<long>( index % SubBucketCount + SubBucketCount ) << shift;
+  }
+
+  static long bucketUpperBound( int index )
+  {
+    if ( index < SubBucketCount )
+      return index;
+    return bucketLowerBound( index ) + ( 1L << ( index / SubBucketCount - 1 ) ) - 1;
+  }
+
+private:
+  static int highestBit( uint64_t v )
+  {
+#ifdef __GNUC__
+    return 63 - __builtin_clzll( v );
+#else
+    int result = 0;
+    while ( v >>= 1 ) ++result;
+    return result;
+#endif
+  }
+
+  std::array<uint64_t, BucketCount> buckets_{};
+  uint64_t count_ = 0;
+};
+
+/*!
+ * Fixed memory statistics over an unbounded number of runs.
+ * Mean and variance are computed with Welford's online algorithm, percentiles are estimated from a LogHistogram.
+ * Runs with a time of -1 are counted as invalid and otherwise ignored.
+ */
+class RunStatistics
+{
+public:
+  void add( long time )
+  {
+    if ( time == -1 ) {
+      ++invalid_count_;
+      return;
+    }
+    ++count_;
+    sum_ += time;
+    if ( time < min_ )
+      min_ = time;
+    if ( time > max_ )
+      max_ = time;
+    double delta = time - mean_;
+    mean_ += delta / count_;
+    m2_ += delta * ( time - mean_ );
+    histogram_.add( time );
+  }
+
+  //! Combines the statistics of two disjoint sets of runs (Chan et al.).
+  void merge( const RunStatistics &other )
+  {
+    if ( other.count_ != 0 ) {
+      uint64_t count = count_ + other.count_;
+      double delta = other.mean_ - mean_;
+      mean_ += delta * other.count_ / count;
+      m2_ += other.m2_ + delta * delta * ( static_cast<double>( count_ ) * other.count_ / count );
+      count_ = count;
+      sum_ += other.sum_;
+      if ( other.min_ < min_ )
+        min_ = other.min_;
+      if ( other.max_ > max_ )
+        max_ = other.max_;
+      histogram_.merge( other.histogram_ );
+    }
+    invalid_count_ += other.invalid_count_;
+  }
+
+  void clear() { *this = RunStatistics(); }
+
+  /*!
+   * The statistics of the runs added after the given earlier state of these statistics, e.g., to report a window
+   * without resetting the statistics. Min and max of the window are estimated from the histogram.
+   */
+  RunStatistics since( const RunStatistics &earlier ) const
+  {
+    RunStatistics result;
+    result.invalid_count_ = invalid_count_ - earlier.invalid_count_;
+    if ( count_ <= earlier.count_ )
+      return result;
+    result.count_ = count_ - earlier.count_;
+    result.sum_ = sum_ - earlier.sum_;
+    result.mean_ = static_cast<double>( result.sum_ ) / result.count_;
+    // Chan's merge solved for the second set
+    double delta = result.mean_ - earlier.mean_;
+    result.m2_ = m2_ - earlier.m2_ - delta * delta * ( static_cast<double>( earlier.count_ ) * result.count_ / count_ );
+    if ( result.m2_ < 0 )
+      result.m2_ = 0;
+    result.histogram_ = histogram_;
+    result.histogram_.subtract( earlier.histogram_ );
+    for ( int i = 0; i < LogHistogram::BucketCount; ++i ) {
+      if ( result.histogram_.bucket( i ) == 0 )
+        continue;
+      result.min_ = std::max( min_, LogHistogram::bucketLowerBound( i ) );
+      break;
+    }
+    for ( int i = LogHistogram::BucketCount - 1; i >= 0; --i ) {
+      if ( result.histogram_.bucket( i ) == 0 )
+        continue;
+      result.max_ = std::min( max_, LogHistogram::bucketUpperBound( i ) );
+      break;
+    }
+    return result;
+  }
+
+  /*!
+   * Restores statistics from their raw state, e.g., after they were accumulated in a different representation.
+   * @param mean The mean of the valid runs.
+   * @param m2 The sum of squared differences from the mean of the valid runs.
+   */
+  static RunStatistics fromState( uint64_t count, uint64_t invalid_count, long min, long max, long long sum,
+                                  double mean, double m2, const LogHistogram &histogram )
+  {
+    RunStatistics result;
+    result.count_ = count;
+    result.invalid_count_ = invalid_count;
+    result.min_ = min;
+    result.max_ = max;
+    result.sum_ = sum;
+    result.mean_ = mean;
+    result.m2_ = m2;
+    result.histogram_ = histogram;
+    return result;
+  }
+
+  //! The number of valid runs.
+  uint64_t count() const { return count_; }
+
+  uint64_t invalidCount() const { return invalid_count_; }
+
+  long min() const { return count_ == 0 ? 0 : min_; }
+
+  long max() const { return max_; }
+
+  long long sum() const { return sum_; }
+
+  double mean() const { return mean_; }
+
+  //! The sample variance.
+  double variance() const { return count_ < 2 ? 0.0 : m2_ / ( count_ - 1 ); }
+
+  double stddev() const { return std::sqrt( variance() ); }
+
+  //! @copydoc LogHistogram::percentile The result is clamped to the longest run.
+  long percentile( double percent ) const
+  {
+    long result = histogram_.percentile( percent );
+    return result > max_ ? max_ : result;
+  }
+
+  const LogHistogram &histogram() const { return histogram_; }
+
+private:
+  uint64_t count_ = 0;
+  uint64_t invalid_count_ = 0;
+  long min_ = std::numeric_limits<long>::max();
+  long max_ = 0;
+  long long sum_ = 0;
+  double mean_ = 0;
+  double m2_ = 0;
+  LogHistogram histogram_;
+};
+
+class PerfCounters;
+
+/*!
+ * Members of BasicTimer that do not depend on its clock.
  */
-class Timer
+class TimerBase
 {
 public:
   enum TimeUnit { Default = 0, Seconds = 1, Milliseconds = 2, Microseconds = 3, Nanoseconds = 4 };
 
+  enum AllocationStatistic { Allocations = 0, AllocatedBytes = 1, FreedBytes = 2 };
+
+  /*!
+   * How the times of finished runs are stored.
+   * KeepAll keeps every run which allows exact analysis but grows without bound.
+   * Streaming only keeps RunStatistics which use fixed memory and provide mean, stddev and percentiles.
+   * Reservoir additionally keeps a uniform random sample of a fixed number of runs (Algorithm R), e.g., to plot their
+   *  distribution. Count, min and max are still exact since they are computed over all runs.
+   */
+  enum RunHistory { KeepAll = 0, Streaming = 1, Reservoir = 2 };
+
   static inline bool getCpuTime( long &val )
   {
     // This could also maybe made a parameter
@@ -51,6 +331,330 @@ public:
     return true;
   }
 
+  /*!
+   * Formats run statistics the same way toString does for a Streaming timer.
+   */
+  static std::string printStatistics( const std::string &name, const RunStatistics &run_stats,
+                                      const RunStatistics &cpu_run_stats, TimeUnit print_time_unit );
+
+  //! Formats the statistics of perf_event counter deltas as additional rows of the printStatistics table.
+  static std::string printPerfStatistics( const PerfCounters &counters, const std::vector<RunStatistics> &stats );
+
+  //! Formats the statistics of heap allocations, indexed by AllocationStatistic, as rows of the printStatistics table.
+  static std::string printAllocationStatistics( const std::vector<RunStatistics> &stats );
+
+protected:
+  static std::string internalPrint( const std::string &name, const std::vector<long> &run_times,
+                                    const std::vector<long> &cpu_run_times,
+                                    TimeUnit print_time_unit );
+};
+
+/*!
+ * Clock policy using std::chrono::high_resolution_clock.
+ * Both the wall and the cpu clock are read twice at start and stop to cancel out the measurement overhead
+ * (see BasicTimer::start).
+ */
+struct ChronoClock {
+  using time_point = std::chrono::high_resolution_clock::time_point;
+
+  static time_point now() { return std::chrono::high_resolution_clock::now(); }
+
+  static long toNanoseconds( const time_point &start, const time_point &end )
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>( end - start ).count();
+  }
+
+  static constexpr bool compensateOverhead() { return true; }
+
+  static constexpr bool measureCpuTime() { return true; }
+
+  static constexpr long wallOverhead() { return 0; }
+
+  static constexpr long cpuOverhead() { return 0; }
+};
+
+/*!
+ * Clock policy using std::chrono::high_resolution_clock with a single read of the wall and the cpu clock at start and
+ * stop. Instead of compensating the measurement overhead with a second read of each clock like ChronoClock, the
+ * overhead of an empty block is measured once on first use as the median of many iterations and subtracted from
+ * every run.
+ */
+struct CalibratedClock {
+  using time_point = ChronoClock::time_point;
+
+  static time_point now() { return ChronoClock::now(); }
+
+  static long toNanoseconds( const time_point &start, const time_point &end )
+  {
+    return ChronoClock::toNanoseconds( start, end );
+  }
+
+  static constexpr bool compensateOverhead() { return false; }
+
+  static constexpr bool measureCpuTime() { return true; }
+
+  //! The wall time an empty block takes in nanoseconds.
+  static long wallOverhead() { return calibration().wall; }
+
+  //! The cpu time an empty block takes in nanoseconds.
+  static long cpuOverhead() { return calibration().cpu; }
+
+private:
+  struct Calibration {
+    long wall = 0;
+    long cpu = 0;
+  };
+
+  static const Calibration &calibration()
+  {
+    static const Calibration calibration = calibrate();
+    return calibration;
+  }
+
+  static Calibration calibrate()
+  {
+    constexpr int warmup = 100;
+    constexpr int iterations = 10001;
+    std::vector<long> wall, cpu;
+    wall.reserve( iterations );
+    cpu.reserve( iterations );
+    for ( int i = 0; i < warmup + iterations; ++i ) {
+      // Same order as the single read path of BasicTimer::start and BasicTimer::stop
+      long cpu_start = 0, cpu_end = 0;
+      bool cpu_valid = TimerBase::getCpuTime( cpu_start );
+      time_point start = now();
+      time_point end = now();
+      cpu_valid = TimerBase::getCpuTime( cpu_end ) && cpu_valid;
+      if ( i < warmup )
+        continue;
+      wall.push_back( toNanoseconds( start, end ) );
+      if ( cpu_valid )
+        cpu.push_back( cpu_end - cpu_start );
+    }
+    Calibration result;
+    std::nth_element( wall.begin(), wall.begin() + wall.size() / 2, wall.end() );
+    result.wall = wall[wall.size() / 2];
+    if ( !cpu.empty() ) {
+      std::nth_element( cpu.begin(), cpu.begin() + cpu.size() / 2, cpu.end() );
+      result.cpu = cpu[cpu.size() / 2];
+    }
+    return result;
+  }
+};
+
+/*!
+ * Clock policy reading the invariant time stamp counter of x86 CPUs with rdtscp.
+ * The counter is calibrated against std::chrono::steady_clock once during static initialization, i.e., when the program
+ * or library including this header is loaded (takes ~10ms), so that the first timed block does not pay for it.
+ * Blocks timed during the static initialization of other translation units may use the steady_clock fallback.
+ * Reading it takes a few nanoseconds compared to the double wall and thread time reads of ChronoClock, hence, it is
+ * meant for very short blocks. Thread time is not measured since reading it requires a system call.
+ * If the CPU has no invariant TSC, the policy falls back to the behavior of ChronoClock using steady_clock.
+ */
+struct TscClock {
+  //! Ticks of the TSC or nanoseconds of the steady_clock if there is no invariant TSC.
+  using time_point = long;
+
+  static inline time_point now()
+  {
+#if ( defined( __x86_64__ ) || defined( __i386__ ) ) && defined( __GNUC__ )
+    if ( calibration_.invariant ) {
+      unsigned int aux;
+      return static_cast<long>( __rdtscp( &aux ) );
+    }
+#endif
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch() )
+        .count();
+  }
+
+  static inline long toNanoseconds( time_point start, time_point end )
+  {
+    return static_cast<long>( ( end - start ) * nanosecondsPerTick() );
+  }
+
+  static bool compensateOverhead() { return !isInvariant(); }
+
+  static bool measureCpuTime() { return !isInvariant(); }
+
+  static constexpr long wallOverhead() { return 0; }
+
+  static constexpr long cpuOverhead() { return 0; }
+
+  //! @return True if the CPU has an invariant TSC which is used instead of the steady_clock.
+  static bool isInvariant() { return calibration_.invariant; }
+
+  static double nanosecondsPerTick() { return calibration_.invariant ? calibration_.ns_per_tick : 1.0; }
+
+private:
+  //! Zero-initialized until the calibration ran, which is the steady_clock fallback.
+  struct Calibration {
+    bool invariant;
+    double ns_per_tick;
+  };
+
+  static Calibration calibrate()
+  {
+    Calibration result{ false, 1.0 };
+#if ( defined( __x86_64__ ) || defined( __i386__ ) ) && defined( __GNUC__ )
+    unsigned int eax, ebx, ecx, edx;
+    // rdtscp support: CPUID 0x80000001 EDX bit 27, invariant TSC: CPUID 0x80000007 EDX bit 8
+    if ( !__get_cpuid( 0x80000001, &eax, &ebx, &ecx, &edx ) || !( edx & ( 1u << 27 ) ) )
+      return result;
+    if ( !__get_cpuid( 0x80000007, &eax, &ebx, &ecx, &edx ) || !( edx & ( 1u << 8 ) ) )
+      return result;
+    unsigned int aux;
+    auto wall_start = std::chrono::steady_clock::now();
+    unsigned long long tsc_start = __rdtscp( &aux );
+    std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+    auto wall_end = std::chrono::steady_clock::now();
+    unsigned long long tsc_end = __rdtscp( &aux );
+    if ( tsc_end <= tsc_start )
+      return result;
+    result.ns_per_tick =
+        std::chrono::duration<double, std::nano>( wall_end - wall_start ).count() / ( tsc_end - tsc_start );
+    result.invariant = true;
+#endif
+    return result;
+  }
+
+  static inline Calibration calibration_ = calibrate();
+};
+
+/*!
+ * Group of perf_event counters of the thread that constructed it, read together with a single system call.
+ * Opens the hardware counters cycles, instructions, cache misses and branch misses. If hardware counters are not
+ * available, e.g., in containers or VMs, it falls back to the software counters page faults, context switches and CPU
+ * migrations. Hardware counters only count user space so they work with the default perf_event_paranoid setting.
+ * Software counters include the kernel if permitted. Otherwise, e.g., for unprivileged processes with the default
+ * perf_event_paranoid of 2, they are opened for user space only, see countsKernel(). Depending on the kernel, events
+ * it handles on behalf of the thread, like page faults and context switches, are then not counted.
+ * Values are scaled if the kernel multiplexed the counters.
+ */
+class PerfCounters
+{
+public:
+  static constexpr int MaxCounters = 4;
+  using Values = std::array<uint64_t, MaxCounters>;
+
+  PerfCounters()
+  {
+    fds_.fill( -1 );
+#ifdef __linux__
+    if ( open( { { { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "cycles" },
+                   { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instr" },
+                   { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, "cache-m" },
+                   { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, "branch-m" } } },
+               4, true, true ) )
+      return;
+    const std::array<Event, MaxCounters> software = { { { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS, "faults" },
+                                                        { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, "ctx-sw" },
+                                                        { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS, "migr" } } };
+    if ( !open( software, 3, false, false ) && ( errno == EACCES || errno == EPERM ) )
+      open( software, 3, false, true );
+#endif
+  }
+
+  ~PerfCounters() { close(); }
+
+  PerfCounters( const PerfCounters & ) = delete;
+  PerfCounters &operator=( const PerfCounters & ) = delete;
+
+  //! @return False if neither hardware nor software counters could be opened.
+  bool isAvailable() const { return count_ != 0; }
+
+  bool isHardware() const { return hardware_; }
+
+  //! False if the counters only count user space, which is always the case for hardware counters.
+  bool countsKernel() const { return counts_kernel_; }
+
+  int count() const { return count_; }
+
+  const char *name( int index ) const { return names_[index]; }
+
+  //! Reads the current values of all counters. @return False if reading failed.
+  bool read( Values &values ) const
+  {
+#ifdef __linux__
+    if ( count_ == 0 )
+      return false;
+    // Layout for PERF_FORMAT_GROUP with the total times: nr, time_enabled, time_running, values[nr]
+    uint64_t buffer[3 + MaxCounters];
+    ssize_t size = ::read( fds_[0], buffer, sizeof( buffer ) );
+    if ( size < static_cast<ssize_t>( ( 3 + count_ ) * sizeof( uint64_t ) ) )
+      return false;
+    double scale = buffer[2] != 0 && buffer[2] < buffer[1] ? static_cast<double>( buffer[1] ) / buffer[2] : 1.0;
+    for ( int i = 0; i < count_; ++i ) values[i] = static_cast<uint64_t>( buffer[3 + i] * scale );
+    return true;
+#else
+    (void)values;
+    return false;
+#endif
+  }
+
+private:
+  struct Event {
+    uint32_t type;
+    uint64_t config;
+    const char *name;
+  };
+
+#ifdef __linux__
+  //! @return False if an event could not be opened, errno is set by perf_event_open.
+  bool open( const std::array<Event, MaxCounters> &events, int count, bool hardware, bool exclude_kernel )
+  {
+    for ( int i = 0; i < count; ++i ) {
+      perf_event_attr attr{};
+      attr.size = sizeof( attr );
+      attr.type = events[i].type;
+      attr.config = events[i].config;
+      attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      attr.exclude_kernel = exclude_kernel;
+      attr.exclude_hv = 1;
+      int fd = static_cast<int>( syscall( SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fds_[0], 0 ) );
+      if ( fd == -1 ) {
+        int error = errno;
+        close();
+        errno = error;
+        return false;
+      }
+      fds_[i] = fd;
+      names_[i] = events[i].name;
+      count_ = i + 1;
+    }
+    hardware_ = hardware;
+    counts_kernel_ = !exclude_kernel;
+    return true;
+  }
+#endif
+
+  void close()
+  {
+#ifdef __linux__
+    for ( int i = count_ - 1; i >= 0; --i ) ::close( fds_[i] );
+#endif
+    fds_.fill( -1 );
+    count_ = 0;
+  }
+
+  std::array<int, MaxCounters> fds_;
+  std::array<const char *, MaxCounters> names_{};
+  int count_ = 0;
+  bool hardware_ = false;
+  bool counts_kernel_ = false;
+};
+
+/*!
+ * Timer class that can be used for simple profiling.
+ * The runtime of a single method can be measured using the static time method.
+ * To measure multiple runs use a Timer instance and pass true to the reset method between runs.
+ * @tparam Clock The clock policy, see ChronoClock (used by Timer), TscClock (used by TscTimer) and CalibratedClock
+ *   (used by CalibratedTimer).
+ */
+template<typename Clock>
+class BasicTimer : public TimerBase
+{
+public:
   /*!
    * Constructs a new Timer instance.
    * @param name: The name of the timer. Used for printing in the toString method and stream operator.
@@ -58,16 +662,19 @@ public:
    * @param autostart If true, the timer starts immediately after construction. If false, it has to be manually started
    *  using the start() method.
    * @param print_on_destruct If true, prints when the Time object is destructed.
+   * @param run_history Whether all run times are kept or only their statistics. Use Streaming for long running timers.
+   * @param reservoir_size The number of runs sampled if the run history is Reservoir.
    */
-  explicit Timer( std::string name, TimeUnit print_time_unit = Default, bool autostart = true,
-                  bool print_on_destruct = false );
+  explicit BasicTimer( std::string name, TimeUnit print_time_unit = Default, bool autostart = true,
+                       bool print_on_destruct = false, RunHistory run_history = KeepAll,
+                       size_t reservoir_size = 1024 );
 
-  ~Timer();
+  ~BasicTimer();
 
   template<typename Fn>
   static auto time( Fn &&fn, const std::string &name, TimeUnit print_time_unit )
   {
-    Timer timer( name, print_time_unit, true, true );
+    BasicTimer timer( name, print_time_unit, true, true );
     return fn();
   }
 
@@ -102,6 +709,9 @@ public:
 
   const std::string &name() const { return name_; }
 
+  //! The name interned by the TraceRecorder, which stays valid after the timer was destroyed. Interned on first use.
+  const char *traceName() const;
+
   /*!
    * Starts the timer if it isn't already running.
    */
@@ -110,6 +720,17 @@ public:
     if ( running_ )
       return;
     running_ = true;
+    if ( perf_counters_ != nullptr )
+      perf_valid_ = perf_valid_ && perf_counters_->read( perf_start_ );
+    if ( !allocation_run_stats_.empty() )
+      allocation_start_ = AllocationTracker::current();
+    if ( !Clock::compensateOverhead() ) {
+      // Single read of each clock, the measurement overhead is assumed to be negligible
+      cpu_time_valid_b_ = false;
+      cpu_time_valid_a_ = Clock::measureCpuTime() && getCpuTime( cpu_start_a_ );
+      start_b_ = Clock::now();
+      return;
+    }
     /*
      * To get a more accurate measurement, the time it takes to measure the time is subtracted by using the following method:
      * We assume that each measurement takes roughly the same time
@@ -135,8 +756,8 @@ public:
      * Diff Wall time = Wall time A - Wall time B = XR + XI + XR + XI = 2 * (XR + XI)
      * Wall time = Wall time B - 1/2 * Diff Wall time - 2 * Diff CPU = 1.5 * Wall time B - 0.5 * Wall time A - 2 * Diff CPU = R
      */
-    start_a_ = std::chrono::high_resolution_clock::now();
-    start_b_ = std::chrono::high_resolution_clock::now();
+    start_a_ = Clock::now();
+    start_b_ = Clock::now();
     cpu_time_valid_a_ = getCpuTime( cpu_start_a_ );
     cpu_time_valid_b_ = getCpuTime( cpu_start_b_ );
   }
@@ -148,6 +769,15 @@ public:
   {
     if ( !running_ )
       return;
+    if ( !Clock::compensateOverhead() ) {
+      elapsed_time_ += std::max( 0L, Clock::toNanoseconds( start_b_, Clock::now() ) - Clock::wallOverhead() );
+      long time;
+      if ( cpu_time_valid_a_ && ( cpu_time_valid_a_ = getCpuTime( time ) ) )
+        elapsed_cpu_time_ += std::max( 0L, time - cpu_start_a_ - Clock::cpuOverhead() );
+      running_ = false;
+      stopCounters();
+      return;
+    }
     // See start method for a documentation of the algorithm used to get precise time measurements
     long time_a = 0;
     long time_b = 0;
@@ -157,8 +787,8 @@ public:
       }
       cpu_time_valid_a_ = getCpuTime( time_a );
     }
-    auto time_point_b = std::chrono::high_resolution_clock::now();
-    auto time_point_a = std::chrono::high_resolution_clock::now();
+    auto time_point_b = Clock::now();
+    auto time_point_a = Clock::now();
     long cpu_diff = 0;
     if ( cpu_time_valid_a_ ) {
       long elapsed;
@@ -168,16 +798,15 @@ public:
       } else {
         elapsed = time_a - cpu_start_a_;
       }
-      assert( elapsed >= 0 );
-      elapsed_cpu_time_ += elapsed;
+      // The compensation can exceed the measured time of blocks that are shorter than the jitter of the clock reads
+      elapsed_cpu_time_ += std::max( 0L, elapsed );
     }
-    long wall_time_b = internalGetDuration( start_b_, time_point_b );
-    long wall_time_a = internalGetDuration( start_a_, time_point_a );
+    long wall_time_b = Clock::toNanoseconds( start_b_, time_point_b );
+    long wall_time_a = Clock::toNanoseconds( start_a_, time_point_a );
     long elapsed = wall_time_b + wall_time_b / 2 - wall_time_a / 2 - 2 * cpu_diff;
-
-    assert( elapsed >= 0 );
-    elapsed_time_ += elapsed;
+    elapsed_time_ += std::max( 0L, elapsed );
     running_ = false;
+    stopCounters();
   }
 
   /*!
@@ -196,7 +825,7 @@ public:
   {
     long result = elapsed_time_;
     if ( running_ )
-      result += internalGetDuration( start_b_, std::chrono::high_resolution_clock::now() );
+      result += Clock::toNanoseconds( start_b_, Clock::now() );
     return result;
   }
 
@@ -220,29 +849,94 @@ public:
     return result;
   }
 
+  /*!
+   * @return The times of all runs including the current run. Empty except for the current run if the run history is
+   *  Streaming. If it is Reservoir, the sampled runs in no particular order and the current run.
+   */
   std::vector<long> getRunTimes() const;
 
   std::vector<long> getCpuRunTimes() const;
 
+  /*!
+   * Statistics of all finished runs. Available for every run history.
+   */
+  const RunStatistics &getRunStatistics() const { return run_stats_; }
+
+  const RunStatistics &getCpuRunStatistics() const { return cpu_run_stats_; }
+
+  RunHistory runHistory() const { return run_history_; }
+
+  /*!
+   * Records the deltas of perf_event counters (see PerfCounters) for every following run. The counters count the
+   * thread that calls this method, hence, the timer should only be used on that thread.
+   * @return False if neither hardware nor software counters are available.
+   */
+  bool enablePerfCounters();
+
+  //! @return The counters if enabled and available, nullptr otherwise.
+  const PerfCounters *perfCounters() const { return perf_counters_.get(); }
+
+  //! Statistics of the deltas of the counter with the given index over all finished runs.
+  const RunStatistics &getPerfRunStatistics( int index ) const { return perf_run_stats_[index]; }
+
+  /*!
+   * Records the heap allocations (see AllocationTracker) of every following run. Like the perf counters, only the
+   * allocations of the thread that starts and stops the timer are counted.
+   * @return False if the allocation hooks are not installed.
+   */
+  bool enableAllocationTracking();
+
+  bool isAllocationTrackingEnabled() const { return !allocation_run_stats_.empty(); }
+
+  //! Statistics of the allocations of all finished runs. Only valid if allocation tracking is enabled.
+  const RunStatistics &getAllocationRunStatistics( AllocationStatistic statistic ) const
+  {
+    return allocation_run_stats_[statistic];
+  }
+
   std::string toString() const;
 
 protected:
-  static std::string internalPrint( const std::string &name, const std::vector<long> &run_times,
-                                    const std::vector<long> &cpu_run_times,
-                                    TimeUnit print_time_unit );
+  void addToReservoir( long time, long cpu_time );
 
-  static inline long internalGetDuration( const std::chrono::high_resolution_clock::time_point &start,
-                                          const std::chrono::high_resolution_clock::time_point &end )
+  void stopCounters()
   {
-    return std::chrono::duration_cast<std::chrono::nanoseconds>( end - start ).count();
+    if ( !allocation_run_stats_.empty() ) {
+      const AllocationCounts counts = AllocationTracker::current() - allocation_start_;
+      allocation_elapsed_.allocations += counts.allocations;
+      allocation_elapsed_.allocated_bytes += counts.allocated_bytes;
+      allocation_elapsed_.freed_bytes += counts.freed_bytes;
+    }
+    if ( perf_counters_ == nullptr )
+      return;
+    PerfCounters::Values end;
+    if ( !perf_valid_ || !( perf_valid_ = perf_counters_->read( end ) ) )
+      return;
+    for ( int i = 0; i < perf_counters_->count(); ++i ) perf_elapsed_[i] += end[i] - perf_start_[i];
   }
 
   std::vector<long> run_times_;
   std::vector<long> cpu_run_times_;
+  RunStatistics run_stats_;
+  RunStatistics cpu_run_stats_;
   std::string name_;
+  mutable const char *trace_name_ = nullptr;
   TimeUnit print_time_unit_;
-  std::chrono::high_resolution_clock::time_point start_a_;
-  std::chrono::high_resolution_clock::time_point start_b_;
+  RunHistory run_history_;
+  size_t reservoir_size_;
+  //! Number of runs offered to the reservoir.
+  uint64_t reservoir_seen_ = 0;
+  std::minstd_rand reservoir_random_;
+  std::shared_ptr<PerfCounters> perf_counters_;
+  std::vector<RunStatistics> perf_run_stats_;
+  PerfCounters::Values perf_start_{};
+  PerfCounters::Values perf_elapsed_{};
+  bool perf_valid_ = true;
+  std::vector<RunStatistics> allocation_run_stats_;
+  AllocationCounts allocation_start_;
+  AllocationCounts allocation_elapsed_;
+  typename Clock::time_point start_a_{};
+  typename Clock::time_point start_b_{};
   long elapsed_time_ = 0;
   long elapsed_cpu_time_ = 0;
   long cpu_start_a_ = 0;
@@ -253,12 +947,138 @@ protected:
   bool print_on_destruct_ = false;
 };
 
+using Timer = BasicTimer<ChronoClock>;
+using TscTimer = BasicTimer<TscClock>;
+using CalibratedTimer = BasicTimer<CalibratedClock>;
+
+/*!
+ * Records begin and end events of time blocks into a preallocated ring per thread which can be written as Chrome
+ * trace-event JSON and loaded into Perfetto (ui.perfetto.dev) or chrome://tracing.
+ *
+ * Recording is disabled by default. Once enabled, each thread allocates its ring when it records its first event and
+ * overwrites its oldest events when the ring is full. Recording an event does not take a lock.
+ * Events are timestamped with the steady clock independent of the clock of the timer.
+ *
+ * Event names are stored as pointers. Names that do not live until the program exits, e.g., of timers, have to be
+ * interned. The timers and blocks of hector_timeit intern their names once on first use.
+ */
+class TraceRecorder
+{
+public:
+  /*!
+   * Enables recording.
+   * @param events_per_thread The capacity of the ring of each thread. Only applies to threads that did not record
+   *   an event yet.
+   */
+  static void enable( size_t events_per_thread = 1 << 16 );
+
+  static void disable() { state().enabled.store( false, std::memory_order_relaxed ); }
+
+  static bool isEnabled() { return state().enabled.load( std::memory_order_relaxed ); }
+
+  //! @param name Has to stay valid until the program exits, e.g., a string literal or a name returned by intern.
+  static void begin( const char *name ) { record( name, 'B' ); }
+
+  static void end( const char *name ) { record( name, 'E' ); }
+
+  /*!
+   * Copies the name into a table that is never freed. Equal names share a copy.
+   * Takes a lock, hence, the result should be kept, e.g., per timer.
+   */
+  static const char *intern( const std::string &name );
+
+  //! Writes the events currently in the rings of all threads as Chrome trace-event JSON.
+  static void writeJson( std::ostream &stream );
+
+  //! @return False if the file could not be written.
+  static bool writeJson( const std::string &path );
+
+private:
+  struct Event {
+    std::atomic<const char *> name;
+    std::atomic<int64_t> timestamp;
+    std::atomic<char> phase;
+  };
+
+  struct Ring {
+    Ring( size_t capacity, size_t index ) : events( new Event[capacity] ), capacity( capacity ), index( index ) { }
+
+    std::unique_ptr<Event[]> events;
+    size_t capacity;
+    size_t index;
+    //! Number of the event being written + 1. Events that may be overwritten are skipped when writing the trace.
+    std::atomic<uint64_t> writing{ 0 };
+    //! Number of completely written events.
+    std::atomic<uint64_t> written{ 0 };
+  };
+
+  struct State {
+    std::atomic<bool> enabled{ false };
+    std::atomic<size_t> capacity{ 1 << 16 };
+    std::mutex mutex;
+    std::vector<std::shared_ptr<Ring>> rings;
+  };
+
+  static State &state()
+  {
+    static State state;
+    return state;
+  }
+
+  struct Names {
+    std::mutex mutex;
+    std::unordered_set<std::string> names;
+  };
+
+  static Names &names()
+  {
+    // Never destroyed, so that interned names stay valid during static destruction
+    static Names *names = new Names;
+    return *names;
+  }
+
+  static void record( const char *name, char phase )
+  {
+    int64_t timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now().time_since_epoch() )
+                            .count();
+    Ring &ring = localRing();
+    uint64_t number = ring.written.load( std::memory_order_relaxed );
+    ring.writing.store( number + 1, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+    Event &event = ring.events[number % ring.capacity];
+    event.name.store( name, std::memory_order_relaxed );
+    event.timestamp.store( timestamp, std::memory_order_relaxed );
+    event.phase.store( phase, std::memory_order_relaxed );
+    ring.written.store( number + 1, std::memory_order_release );
+  }
+
+  static Ring &localRing()
+  {
+    thread_local std::shared_ptr<Ring> ring = [] {
+      State &state = TraceRecorder::state();
+      std::lock_guard<std::mutex> lock( state.mutex );
+      state.rings.push_back(
+          std::make_shared<Ring>( state.capacity.load( std::memory_order_relaxed ), state.rings.size() ) );
+      return state.rings.back();
+    }();
+    return *ring;
+  }
+};
+
 /*!
  * @brief Helper class to measure individual runs on a timer.
  * Starts the timer on construction and stops and resets the next run timer on destruction.
+ * If the TraceRecorder is enabled when the block is constructed, the block is recorded as begin and end event.
  */
+template<typename Clock = ChronoClock>
 struct TimeBlock {
-  explicit TimeBlock( Timer &timer ) : timer_( timer ) { timer_.start(); }
+  explicit TimeBlock( BasicTimer<Clock> &timer ) : timer_( timer ), traced_( TraceRecorder::isEnabled() )
+  {
+    if ( traced_ )
+      TraceRecorder::begin( timer_.traceName() );
+    timer_.start();
+  }
 
   ~TimeBlock()
   {
@@ -271,58 +1091,141 @@ struct TimeBlock {
     if ( ended_ ) return;
     ended_ = true;
     timer_.reset( true );
+    if ( traced_ )
+      TraceRecorder::end( timer_.traceName() );
   }
 
-  Timer &timer_;
+  BasicTimer<Clock> &timer_;
+  bool traced_;
   bool ended_ = false;
 };
 
 } // namespace hector_timeit
 
-std::ostream &operator<<( std::ostream &stream, const hector_timeit::Timer &timer );
+template<typename Clock>
+std::ostream &operator<<( std::ostream &stream, const hector_timeit::BasicTimer<Clock> &timer );
 
 // IMPL
+#include <algorithm>
 #include <cmath>
+#include <fstream>
 #include <iostream>
 #include <sstream>
 
 namespace hector_timeit
 {
 
-inline Timer::Timer( std::string name, TimeUnit print_time_unit, bool autostart,
-                     bool print_on_destruct )
-    : name_( std::move( name ) ), print_time_unit_( print_time_unit ),
-      print_on_destruct_( print_on_destruct )
+template<typename Clock>
+inline BasicTimer<Clock>::BasicTimer( std::string name, TimeUnit print_time_unit, bool autostart,
+                                      bool print_on_destruct, RunHistory run_history, size_t reservoir_size )
+    : name_( std::move( name ) ), print_time_unit_( print_time_unit ), run_history_( run_history ),
+      reservoir_size_( reservoir_size ), print_on_destruct_( print_on_destruct )
 {
+  if ( run_history_ == Reservoir ) {
+    run_times_.reserve( reservoir_size_ );
+    cpu_run_times_.reserve( reservoir_size_ );
+  }
   if ( autostart )
     start();
 }
 
-inline Timer::~Timer()
+template<typename Clock>
+inline BasicTimer<Clock>::~BasicTimer()
 {
   if ( print_on_destruct_ )
     std::cout << *this << std::endl << std::flush;
 }
 
-inline void Timer::reset( bool new_run )
+template<typename Clock>
+inline void BasicTimer<Clock>::reset( bool new_run )
 {
   stop();
   if ( new_run ) {
     if ( elapsed_time_ > 0 ) {
-      run_times_.push_back( elapsed_time_ );
-      cpu_run_times_.push_back( cpu_time_valid_a_ ? elapsed_cpu_time_ : -1 );
+      long cpu_time = cpu_time_valid_a_ ? elapsed_cpu_time_ : -1;
+      run_stats_.add( elapsed_time_ );
+      cpu_run_stats_.add( cpu_time );
+      if ( run_history_ == KeepAll ) {
+        run_times_.push_back( elapsed_time_ );
+        cpu_run_times_.push_back( cpu_time );
+      } else if ( run_history_ == Reservoir ) {
+        addToReservoir( elapsed_time_, cpu_time );
+      }
+      for ( size_t i = 0; i < perf_run_stats_.size(); ++i )
+        perf_run_stats_[i].add( perf_valid_ ? static_cast<long>( perf_elapsed_[i] ) : -1 );
+      if ( !allocation_run_stats_.empty() ) {
+        allocation_run_stats_[Allocations].add( static_cast<long>( allocation_elapsed_.allocations ) );
+        allocation_run_stats_[AllocatedBytes].add( static_cast<long>( allocation_elapsed_.allocated_bytes ) );
+        allocation_run_stats_[FreedBytes].add( static_cast<long>( allocation_elapsed_.freed_bytes ) );
+      }
     }
   } else {
     run_times_.clear();
     cpu_run_times_.clear();
+    reservoir_seen_ = 0;
+    for ( auto &stats : perf_run_stats_ ) stats.clear();
+    for ( auto &stats : allocation_run_stats_ ) stats.clear();
+    run_stats_.clear();
+    cpu_run_stats_.clear();
   }
   elapsed_time_ = 0;
   elapsed_cpu_time_ = 0;
   cpu_time_valid_a_ = true;
   cpu_time_valid_b_ = true;
+  perf_elapsed_.fill( 0 );
+  perf_valid_ = true;
+  allocation_elapsed_ = AllocationCounts();
+}
+
+template<typename Clock>
+inline const char *BasicTimer<Clock>::traceName() const
+{
+  if ( trace_name_ == nullptr )
+    trace_name_ = TraceRecorder::intern( name_ );
+  return trace_name_;
+}
+
+template<typename Clock>
+inline bool BasicTimer<Clock>::enablePerfCounters()
+{
+  if ( perf_counters_ != nullptr )
+    return true;
+  auto counters = std::make_shared<PerfCounters>();
+  if ( !counters->isAvailable() )
+    return false;
+  perf_counters_ = std::move( counters );
+  perf_run_stats_.resize( perf_counters_->count() );
+  return true;
+}
+
+template<typename Clock>
+inline bool BasicTimer<Clock>::enableAllocationTracking()
+{
+  if ( !AllocationTracker::isAvailable() )
+    return false;
+  allocation_run_stats_.resize( 3 );
+  return true;
 }
 
-inline std::vector<long> Timer::getRunTimes() const
+template<typename Clock>
+inline void BasicTimer<Clock>::addToReservoir( long time, long cpu_time )
+{
+  ++reservoir_seen_;
+  if ( run_times_.size() < reservoir_size_ ) {
+    run_times_.push_back( time );
+    cpu_run_times_.push_back( cpu_time );
+    return;
+  }
+  // Replace a sample with probability reservoir_size / seen
+  uint64_t index = std::uniform_int_distribution<uint64_t>( 0, reservoir_seen_ - 1 )( reservoir_random_ );
+  if ( index >= reservoir_size_ )
+    return;
+  run_times_[index] = time;
+  cpu_run_times_[index] = cpu_time;
+}
+
+template<typename Clock>
+inline std::vector<long> BasicTimer<Clock>::getRunTimes() const
 {
   std::vector<long> result = run_times_;
   long elapsed_time = getElapsedTime();
@@ -332,7 +1235,8 @@ inline std::vector<long> Timer::getRunTimes() const
   return result;
 }
 
-inline std::vector<long> Timer::getCpuRunTimes() const
+template<typename Clock>
+inline std::vector<long> BasicTimer<Clock>::getCpuRunTimes() const
 {
   std::vector<long> result = cpu_run_times_;
   long elapsed_cpu_time = getElapsedCpuTime();
@@ -342,9 +1246,32 @@ inline std::vector<long> Timer::getCpuRunTimes() const
   return result;
 }
 
-inline std::string Timer::toString() const
+template<typename Clock>
+inline std::string BasicTimer<Clock>::toString() const
 {
-  return internalPrint( name_, getRunTimes(), getCpuRunTimes(), print_time_unit_ );
+  // Include the current run like getRunTimes does
+  long elapsed_time = getElapsedTime();
+  std::string result;
+  if ( run_history_ == KeepAll ) {
+    result = internalPrint( name_, getRunTimes(), getCpuRunTimes(), print_time_unit_ );
+  } else if ( elapsed_time == 0 ) {
+    result = printStatistics( name_, run_stats_, cpu_run_stats_, print_time_unit_ );
+  } else {
+    RunStatistics run_stats = run_stats_;
+    RunStatistics cpu_run_stats = cpu_run_stats_;
+    run_stats.add( elapsed_time );
+    long elapsed_cpu_time = getElapsedCpuTime();
+    cpu_run_stats.add( elapsed_cpu_time > 0 ? elapsed_cpu_time : -1 );
+    result = printStatistics( name_, run_stats, cpu_run_stats, print_time_unit_ );
+  }
+  if ( perf_counters_ != nullptr )
+    result += printPerfStatistics( *perf_counters_, perf_run_stats_ );
+  if ( !allocation_run_stats_.empty() )
+    result += printAllocationStatistics( allocation_run_stats_ );
+  if ( run_history_ == Reservoir && reservoir_seen_ != 0 )
+    result += "\nReservoir: " + std::to_string( run_times_.size() ) + " of " + std::to_string( reservoir_seen_ ) +
+              " run(s) sampled.";
+  return result;
 }
 
 inline void printPaddedString( std::ostringstream &stream, const std::string &text, size_t pad = 0 )
@@ -356,26 +1283,26 @@ inline void printPaddedString( std::ostringstream &stream, const std::string &te
 }
 
 template<typename T>
-void printTimeString( std::ostringstream &outstream, T time, Timer::TimeUnit print_time_unit,
+void printTimeString( std::ostringstream &outstream, T time, TimerBase::TimeUnit print_time_unit,
                       int pad = 0 )
 {
   std::ostringstream stream;
   stream.precision( 3 );
   stream.setf( std::ios::fixed, std::ios::floatfield );
   switch ( print_time_unit ) {
-  case Timer::Seconds:
+  case TimerBase::Seconds:
     stream << time / 1E9 << "s";
     break;
-  case Timer::Milliseconds:
+  case TimerBase::Milliseconds:
     stream << time / 1E6 << "ms";
     break;
-  case Timer::Microseconds:
+  case TimerBase::Microseconds:
     stream << time / 1000.0 << "us";
     break;
-  case Timer::Nanoseconds:
+  case TimerBase::Nanoseconds:
     stream << time << "ns";
     break;
-  case Timer::Default:
+  case TimerBase::Default:
   default:
     if ( time < 5000 ) {
       stream << time << "ns";
@@ -394,7 +1321,7 @@ void printTimeString( std::ostringstream &outstream, T time, Timer::TimeUnit pri
 inline double square( double x ) { return x * x; }
 
 inline void printStats( std::ostringstream &stream, const std::vector<long> &run_times,
-                        Timer::TimeUnit print_time_unit )
+                        TimerBase::TimeUnit print_time_unit )
 {
   long max = 0;
   long min = INT64_MAX;
@@ -440,9 +1367,121 @@ inline void printStats( std::ostringstream &stream, const std::vector<long> &run
   }
 }
 
-inline std::string Timer::internalPrint( const std::string &name, const std::vector<long> &run_times,
-                                         const std::vector<long> &cpu_run_times,
-                                         TimeUnit print_time_unit )
+inline void printStats( std::ostringstream &stream, const RunStatistics &stats,
+                        TimerBase::TimeUnit print_time_unit )
+{
+  if ( stats.count() == 0 ) {
+    stream << "None of the runs had valid times!";
+    return;
+  }
+  std::ostringstream avg_stream;
+  printTimeString( avg_stream, stats.mean(), print_time_unit, 0 );
+  avg_stream << " +- ";
+  printTimeString( avg_stream, stats.stddev(), print_time_unit, 0 );
+  printPaddedString( stream, avg_stream.str(), 40 );
+  printTimeString( stream, stats.max(), print_time_unit, 16 );
+  printTimeString( stream, stats.min(), print_time_unit, 16 );
+  printTimeString( stream, stats.sum(), print_time_unit, 16 );
+  for ( double percent : { 50.0, 90.0, 99.0, 99.9 } )
+    printTimeString( stream, stats.percentile( percent ), print_time_unit, 12 );
+  if ( stats.invalidCount() != 0 ) {
+    stream << std::endl
+           << "Warning: Only " << stats.count() << " of " << stats.count() + stats.invalidCount()
+           << " had valid times!";
+  }
+}
+
+inline void printCountString( std::ostringstream &stream, double count, int pad )
+{
+  std::ostringstream count_stream;
+  count_stream.precision( 3 );
+  count_stream.setf( std::ios::fixed, std::ios::floatfield );
+  if ( count >= 1e9 )
+    count_stream << count / 1e9 << "G";
+  else if ( count >= 1e6 )
+    count_stream << count / 1e6 << "M";
+  else if ( count >= 1e3 )
+    count_stream << count / 1e3 << "k";
+  else {
+    count_stream.precision( count == std::floor( count ) ? 0 : 2 );
+    count_stream << count;
+  }
+  printPaddedString( stream, count_stream.str(), pad );
+}
+
+inline void printCountStatistics( std::ostringstream &stream, const std::string &name, const RunStatistics &counter )
+{
+  stream << std::endl;
+  printPaddedString( stream, name, 8 );
+  if ( counter.count() == 0 ) {
+    stream << "No valid counts.";
+    return;
+  }
+  std::ostringstream avg_stream;
+  printCountString( avg_stream, counter.mean(), 0 );
+  avg_stream << " +- ";
+  printCountString( avg_stream, counter.stddev(), 0 );
+  printPaddedString( stream, avg_stream.str(), 40 );
+  printCountString( stream, counter.max(), 16 );
+  printCountString( stream, counter.min(), 16 );
+  printCountString( stream, counter.sum(), 16 );
+  for ( double percent : { 50.0, 90.0, 99.0, 99.9 } ) printCountString( stream, counter.percentile( percent ), 12 );
+}
+
+inline std::string TimerBase::printPerfStatistics( const PerfCounters &counters,
+                                                   const std::vector<RunStatistics> &stats )
+{
+  std::ostringstream stream;
+  for ( int i = 0; i < counters.count(); ++i ) printCountStatistics( stream, counters.name( i ), stats[i] );
+  return stream.str();
+}
+
+inline std::string TimerBase::printAllocationStatistics( const std::vector<RunStatistics> &stats )
+{
+  std::ostringstream stream;
+  printCountStatistics( stream, "allocs", stats[Allocations] );
+  printCountStatistics( stream, "alloc-B", stats[AllocatedBytes] );
+  printCountStatistics( stream, "freed-B", stats[FreedBytes] );
+  return stream.str();
+}
+
+inline std::string TimerBase::printStatistics( const std::string &name, const RunStatistics &run_stats,
+                                               const RunStatistics &cpu_run_stats, TimeUnit print_time_unit )
+{
+  std::ostringstream stringstream;
+  uint64_t runs = run_stats.count() + run_stats.invalidCount();
+  stringstream << "[Timer: " << name << "] " << runs << " run(s) took: ";
+  if ( runs == 0 ) {
+    stringstream << "no time at all.";
+    return stringstream.str();
+  }
+  stringstream << std::endl;
+  printPaddedString( stringstream, "Type", 8 );
+  printPaddedString( stringstream, "Mean (+/- stddev)", 40 );
+  printPaddedString( stringstream, "Longest", 16 );
+  printPaddedString( stringstream, "Shortest", 16 );
+  printPaddedString( stringstream, "Sum", 16 );
+  for ( const char *percentile : { "p50", "p90", "p99", "p99.9" } )
+    printPaddedString( stringstream, percentile, 12 );
+  stringstream << std::endl;
+  printPaddedString( stringstream, "Real", 8 );
+  printStats( stringstream, run_stats, print_time_unit );
+  // Clocks like TscClock do not measure thread time at all
+  if ( cpu_run_stats.count() == 0 )
+    return stringstream.str();
+  stringstream << std::endl;
+#ifdef _POSIX_THREAD_CPUTIME
+  printPaddedString( stringstream, "Thread", 8 );
+#else
+  printPaddedString( stringstream, "CPU", 8 );
+#endif
+  printStats( stringstream, cpu_run_stats, print_time_unit );
+  return stringstream.str();
+}
+
+inline std::string TimerBase::internalPrint( const std::string &name, const std::vector<long> &run_times,
+                                             const std::vector<long> &cpu_run_times,
+                                             TimeUnit print_time_unit )
 {
   std::ostringstream stringstream;
   stringstream << "[Timer: " << name << "] " << run_times.size() << " run(s) took: ";
@@ -480,9 +1519,86 @@ inline std::string Timer::internalPrint( const std::string &name, const std::vec
   }
   return stringstream.str();
 }
+inline const char *TraceRecorder::intern( const std::string &name )
+{
+  Names &names = TraceRecorder::names();
+  std::lock_guard<std::mutex> lock( names.mutex );
+  // Elements of an unordered_set are not moved by inserts
+  return names.names.insert( name ).first->c_str();
+}
+
+inline void TraceRecorder::enable( size_t events_per_thread )
+{
+  State &state = TraceRecorder::state();
+  state.capacity.store( events_per_thread < 2 ? 2 : events_per_thread, std::memory_order_relaxed );
+  state.enabled.store( true, std::memory_order_relaxed );
+}
+
+inline void TraceRecorder::writeJson( std::ostream &stream )
+{
+#ifdef __unix__
+  long pid = getpid();
+#else
+  long pid = 0;
+#endif
+  State &state = TraceRecorder::state();
+  std::lock_guard<std::mutex> lock( state.mutex );
+  std::ostringstream events;
+  events.setf( std::ios::fixed, std::ios::floatfield );
+  events.precision( 3 );
+  bool first = true;
+  for ( const auto &ring : state.rings ) {
+    uint64_t written = ring->written.load( std::memory_order_acquire );
+    uint64_t begin = written > ring->capacity ? written - ring->capacity : 0;
+    struct Copy {
+      const char *name;
+      int64_t timestamp;
+      char phase;
+    };
+    std::vector<Copy> copy;
+    copy.reserve( written - begin );
+    for ( uint64_t i = begin; i < written; ++i ) {
+      const Event &event = ring->events[i % ring->capacity];
+      copy.push_back( { event.name.load( std::memory_order_relaxed ),
+                        event.timestamp.load( std::memory_order_relaxed ),
+                        event.phase.load( std::memory_order_relaxed ) } );
+    }
+    // Events the thread started to overwrite while copying are dropped
+    std::atomic_thread_fence( std::memory_order_acquire );
+    uint64_t writing = ring->writing.load( std::memory_order_relaxed );
+    uint64_t valid_begin = writing > ring->capacity ? writing - ring->capacity : 0;
+    for ( uint64_t i = std::max( begin, valid_begin ); i < written; ++i ) {
+      const Copy &event = copy[i - begin];
+      if ( !first )
+        events << ",\n";
+      first = false;
+      events << "{\"name\":\"";
+      for ( const char *c = event.name; *c != '\0'; ++c ) {
+        if ( *c == '"' || *c == '\\' )
+          events << '\\' << *c;
+        else if ( static_cast<unsigned char>( *c ) >= 0x20 )
+          events << *c;
+      }
+      events << "\",\"ph\":\"" << event.phase << "\",\"ts\":" << event.timestamp / 1000.0
+             << ",\"pid\":" << pid << ",\"tid\":" << ring->index + 1 << "}";
+    }
+  }
+  stream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n" << events.str() << "\n]}\n";
+}
+
+inline bool TraceRecorder::writeJson( const std::string &path )
+{
+  std::ofstream file( path );
+  if ( !file )
+    return false;
+  writeJson( file );
+  return static_cast<bool>( file );
+}
+
 } // namespace hector_timeit
 
-inline std::ostream &operator<<( std::ostream &stream, const hector_timeit::Timer &timer )
+template<typename Clock>
+inline std::ostream &operator<<( std::ostream &stream, const hector_timeit::BasicTimer<Clock> &timer )
 {
   return stream << timer.toString();
 }
@@ -0,0 +1,133 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#include "timer_stats_publisher.hpp"
+#include "concurrent_timer.hpp"
+
+#include <diagnostic_msgs/msg/diagnostic_status.hpp>
+#include <diagnostic_msgs/msg/key_value.hpp>
+
+#include <cstdio>
+
+namespace {
+template<typename T>
+diagnostic_msgs::msg::KeyValue keyValue(std::string key, T value) {
+    diagnostic_msgs::msg::KeyValue result;
+    result.key = std::move(key);
+    result.value = std::to_string(value);
+    return result;
+}
+
+diagnostic_msgs::msg::DiagnosticStatus memoryStatus(std::string name, const MemoryAccount::Usage &usage) {
+    diagnostic_msgs::msg::DiagnosticStatus status;
+    status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+    status.name = std::move(name);
+    char message[64];
+    std::snprintf(message, sizeof(message), "%.1f MB GPU, %.1f MB CPU", usage.gpu_bytes / 1048576.0,
+                  usage.cpu_bytes / 1048576.0);
+    status.message = message;
+    // Sizes in kB
+    status.values.push_back(keyValue("gpu_kb", usage.gpu_bytes / 1024.0));
+    status.values.push_back(keyValue("peak_gpu_kb", usage.peak_gpu_bytes / 1024.0));
+    status.values.push_back(keyValue("cpu_kb", usage.cpu_bytes / 1024.0));
+    status.values.push_back(keyValue("peak_cpu_kb", usage.peak_cpu_bytes / 1024.0));
+    for (int resource = 0; resource < MemoryAccount::ResourceCount; ++resource) {
+        if (usage.bytes[resource] == 0) continue;
+        status.values.push_back(keyValue(
+                std::string(MemoryAccount::resourceName(static_cast<MemoryAccount::Resource>(resource))) + "_kb",
+                usage.bytes[resource] / 1024.0));
+    }
+    return status;
+}
+}
+
+TimerStatsPublisher::TimerStatsPublisher(rclcpp::Node::SharedPtr node, const std::string &topic)
+        : node_(std::move(node)), previous_time_(std::chrono::steady_clock::now()) {
+    publisher_ = node_->create_publisher<diagnostic_msgs::msg::DiagnosticArray>(topic, rclcpp::QoS(10));
+}
+
+void TimerStatsPublisher::setRate(double rate) {
+    if (rate == rate_) return;
+    rate_ = rate;
+    timer_.reset();
+    if (rate <= 0) return;
+    timer_ = node_->create_wall_timer(std::chrono::duration<double>(1 / rate), [this] { publish(); });
+}
+
+void TimerStatsPublisher::setFramePacing(const FramePacingAnalyzer *frame_pacing) {
+    frame_pacing_ = frame_pacing;
+}
+
+void TimerStatsPublisher::setGpuMemoryBudget(size_t bytes) {
+    gpu_memory_budget_ = bytes;
+}
+
+void TimerStatsPublisher::publish() {
+    const auto now = std::chrono::steady_clock::now();
+    const double window = std::chrono::duration<double>(now - previous_time_).count();
+    previous_time_ = now;
+    diagnostic_msgs::msg::DiagnosticArray message;
+    message.header.stamp = node_->now();
+    std::unordered_map<size_t, hector_timeit::RunStatistics> current;
+    hector_timeit::ConcurrentTimer::forEach([&](const hector_timeit::ConcurrentTimer &timer) {
+        hector_timeit::RunStatistics stats = timer.getRunStatistics();
+        auto previous = previous_.find(timer.id());
+        const hector_timeit::RunStatistics window_stats =
+                previous == previous_.end() ? stats : stats.since(previous->second);
+        current.emplace(timer.id(), std::move(stats));
+
+        diagnostic_msgs::msg::DiagnosticStatus status;
+        status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+        status.name = "overlay_test: " + timer.name();
+        status.message = std::to_string(window_stats.count()) + " run(s)";
+        // Times in milliseconds
+        status.values.push_back(keyValue("window_s", window));
+        status.values.push_back(keyValue("count", window_stats.count()));
+        status.values.push_back(keyValue("mean_ms", window_stats.mean() / 1e6));
+        status.values.push_back(keyValue("p50_ms", window_stats.percentile(50) / 1e6));
+        status.values.push_back(keyValue("p99_ms", window_stats.percentile(99) / 1e6));
+        status.values.push_back(keyValue("max_ms", window_stats.max() / 1e6));
+        message.status.push_back(std::move(status));
+    });
+    // Timers that were destroyed are dropped
+    previous_ = std::move(current);
+    if (frame_pacing_ != nullptr) {
+        // Over the frames in the analyzer's ring
+        const FramePacingAnalyzer::Report pacing = frame_pacing_->report();
+        diagnostic_msgs::msg::DiagnosticStatus status;
+        status.level = pacing.over_budget == 0 ? diagnostic_msgs::msg::DiagnosticStatus::OK
+                                               : diagnostic_msgs::msg::DiagnosticStatus::WARN;
+        status.name = "overlay_test: frame pacing";
+        status.message = std::to_string(pacing.over_budget) + " of " + std::to_string(pacing.intervals.count()) +
+                         " frame(s) over budget";
+        status.values.push_back(keyValue("frames", pacing.intervals.count()));
+        status.values.push_back(keyValue("budget_ms", pacing.budget / 1e6));
+        status.values.push_back(keyValue("interval_mean_ms", pacing.intervals.mean() / 1e6));
+        status.values.push_back(keyValue("interval_p99_ms", pacing.intervals.percentile(99) / 1e6));
+        status.values.push_back(keyValue("jitter_ms", pacing.jitter() / 1e6));
+        status.values.push_back(keyValue("interval_variation_ms", pacing.interval_variation / 1e6));
+        status.values.push_back(keyValue("longest_stall_ms", pacing.intervals.max() / 1e6));
+        status.values.push_back(keyValue("over_budget", pacing.over_budget));
+        status.values.push_back(keyValue("total_over_budget", pacing.total_over_budget));
+        status.values.push_back(keyValue("content_updates", pacing.content_latency.count()));
+        status.values.push_back(keyValue("content_latency_mean_ms", pacing.content_latency.mean() / 1e6));
+        status.values.push_back(keyValue("content_latency_p99_ms", pacing.content_latency.percentile(99) / 1e6));
+        status.values.push_back(keyValue("content_latency_max_ms", pacing.content_latency.max() / 1e6));
+        message.status.push_back(std::move(status));
+    }
+    MemoryAccount::forEach([&](const MemoryAccount &account) {
+        message.status.push_back(memoryStatus("overlay_test: memory " + account.name(), account.usage()));
+    });
+    const MemoryAccount::Usage total = MemoryAccount::total();
+    diagnostic_msgs::msg::DiagnosticStatus total_status = memoryStatus("overlay_test: memory total", total);
+    if (gpu_memory_budget_ > 0) {
+        total_status.values.push_back(keyValue("gpu_budget_kb", gpu_memory_budget_ / 1024.0));
+        if (total.gpu_bytes > gpu_memory_budget_) {
+            total_status.level = diagnostic_msgs::msg::DiagnosticStatus::WARN;
+            total_status.message += " exceeds the GPU budget";
+        }
+    }
+    message.status.push_back(std::move(total_status));
+    publisher_->publish(message);
+}
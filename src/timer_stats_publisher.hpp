@@ -0,0 +1,55 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#ifndef TIMER_STATS_PUBLISHER_HPP
+#define TIMER_STATS_PUBLISHER_HPP
+
+#include "frame_pacing.hpp"
+#include "memory_account.hpp"
+#include "timer.hpp"
+
+#include <diagnostic_msgs/msg/diagnostic_array.hpp>
+#include <rclcpp/rclcpp.hpp>
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+
+/*!
+ * Periodically publishes the statistics of all hector_timeit::ConcurrentTimers over the last window as a
+ * diagnostic_msgs/DiagnosticArray with one status per timer. These include the CPU stages of the overlay, cpu_frame,
+ * cpu_paint, cpu_readback and cpu_upload, which are recorded even if the profiling scopes are compiled out.
+ * Windows are the difference to the statistics at the previous publish, the timers themselves are never reset, so
+ * the summary printed at exit still covers all runs.
+ * If a FramePacingAnalyzer is set, its report is published as an additional status. The memory of every
+ * MemoryAccount and the total are published as well.
+ */
+class TimerStatsPublisher {
+public:
+    TimerStatsPublisher(rclcpp::Node::SharedPtr node, const std::string &topic);
+
+    //! @param rate The publish rate in Hz. If not positive, publishing is stopped.
+    void setRate(double rate);
+
+    //! The analyzer has to outlive the publisher.
+    void setFramePacing(const FramePacingAnalyzer *frame_pacing);
+
+    //! The total status is a warning while the accounted GPU memory exceeds the budget. 0 disables the budget.
+    void setGpuMemoryBudget(size_t bytes);
+
+    void publish();
+
+private:
+    rclcpp::Node::SharedPtr node_;
+    rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr publisher_;
+    rclcpp::TimerBase::SharedPtr timer_;
+    double rate_ = 0;
+    const FramePacingAnalyzer *frame_pacing_ = nullptr;
+    size_t gpu_memory_budget_ = 0;
+    //! Statistics of each timer at the previous publish by timer id.
+    std::unordered_map<size_t, hector_timeit::RunStatistics> previous_;
+    std::chrono::steady_clock::time_point previous_time_;
+};
+
+#endif //TIMER_STATS_PUBLISHER_HPP
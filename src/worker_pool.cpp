@@ -0,0 +1,53 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#include "worker_pool.hpp"
+
+#include <algorithm>
+
+WorkerPool::WorkerPool(unsigned size) {
+    if (size == 0) size = std::max(1u, std::thread::hardware_concurrency());
+    threads_.reserve(size - 1);
+    for (unsigned i = 1; i < size; ++i) {
+        threads_.emplace_back(&WorkerPool::workerLoop, this, i);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    start_condition_.notify_all();
+    for (auto &thread : threads_) thread.join();
+}
+
+void WorkerPool::run(const std::function<void(unsigned, unsigned)> &task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = &task;
+        pending_ = static_cast<unsigned>(threads_.size());
+        ++generation_;
+    }
+    start_condition_.notify_all();
+    task(0, size());
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_condition_.wait(lock, [this] { return pending_ == 0; });
+    task_ = nullptr;
+}
+
+void WorkerPool::workerLoop(unsigned index) {
+    uint64_t generation = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        start_condition_.wait(lock, [&] { return stop_ || generation_ != generation; });
+        if (stop_) return;
+        generation = generation_;
+        const auto *task = task_;
+        lock.unlock();
+        (*task)(index, size());
+        lock.lock();
+        if (--pending_ == 0) done_condition_.notify_one();
+    }
+}
@@ -0,0 +1,50 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#ifndef WORKER_POOL_HPP
+#define WORKER_POOL_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*!
+ * Fixed set of threads that run the same task in parallel, e.g., over chunks of a buffer.
+ * Threads are created once and reused for every call to run.
+ */
+class WorkerPool {
+public:
+    /*!
+     * @param size Number of parallel executions per run including the calling thread. If 0, the number of
+     *   hardware threads is used.
+     */
+    explicit WorkerPool(unsigned size = 0);
+
+    ~WorkerPool();
+
+    unsigned size() const { return static_cast<unsigned>(threads_.size()) + 1; }
+
+    /*!
+     * Calls task(index, size()) for every index in [0, size()). Index 0 runs on the calling thread.
+     * Blocks until all executions finished. Must not be called concurrently.
+     */
+    void run(const std::function<void(unsigned, unsigned)> &task);
+
+private:
+    void workerLoop(unsigned index);
+
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable start_condition_;
+    std::condition_variable done_condition_;
+    const std::function<void(unsigned, unsigned)> *task_ = nullptr;
+    uint64_t generation_ = 0;
+    unsigned pending_ = 0;
+    bool stop_ = false;
+};
+
+#endif //WORKER_POOL_HPP
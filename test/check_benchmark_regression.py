@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""
+Regression gate for the overlay render benchmark.
+
+Runs overlay_test_render_benchmark several times, takes the median of every metric over the runs and compares it
+against a checked-in baseline with a relative tolerance per metric. Fails if a throughput metric dropped or a latency
+metric rose by more than its tolerance. The medians of the runs are written as JSON.
+
+Baselines are only meaningful on the machine and renderer they were recorded on. Record one with --update-baseline,
+e.g., on the CI machine. Renderers are compared without the LLVM version of llvmpipe, which changes with every Mesa
+update. If the baseline has no results or the renderer differs, the comparison is skipped unless --strict and the
+script exits with SKIP_RETURN_CODE, so ctest reports the test as skipped instead of passed. With --strict, a baseline
+without results fails.
+
+Every size and metric of the baseline has to be in the results of this run and needs a tolerance and a non-zero value,
+otherwise the comparison fails. Results that are not in the baseline are only printed.
+"""
+
+import argparse
+import json
+import re
+import statistics
+import subprocess
+import sys
+import tempfile
+from pathlib import Path
+
+# Exit code for a comparison that did not run, the SKIP_RETURN_CODE of the ctest
+SKIP_RETURN_CODE = 77
+
+
+def run_benchmark(benchmark, benchmark_args, repeats):
+    runs = []
+    with tempfile.TemporaryDirectory() as directory:
+        for i in range(repeats):
+            path = Path(directory) / f"run_{i}.json"
+            subprocess.run([benchmark, *benchmark_args, "--json", str(path)], check=True)
+            with open(path) as f:
+                runs.append(json.load(f))
+    return runs
+
+
+def renderer_family(renderer):
+    """The renderer without the LLVM version, e.g., 'llvmpipe (LLVM, 256 bits)'. The vector width is kept."""
+    return re.sub(r"LLVM [0-9.]+", "LLVM", renderer) if renderer else renderer
+
+
+def medians(runs):
+    """Median and relative spread (max - min) / median of every metric over the runs."""
+    result = {}
+    for size in runs[0]["results"]:
+        result[size] = {}
+        for metric in runs[0]["results"][size]:
+            values = [run["results"][size][metric] for run in runs]
+            median = statistics.median(values)
+            spread = (max(values) - min(values)) / median if median != 0 else 0.0
+            result[size][metric] = {"median": median, "spread": spread}
+    return result
+
+
+def compare(baseline, current):
+    """@return The list of regressions and baseline entries that could not be compared as printable lines."""
+    regressions = []
+    higher_is_better = set(baseline["higher_is_better"])
+    print(f"{'Size':<11} {'Metric':<14} {'Baseline':>10} {'Median':>10} {'Change':>8} {'Spread':>7}  Result")
+    for size, references in sorted(baseline["results"].items()):
+        for metric, reference in sorted(references.items()):
+            value = current.get(size, {}).get(metric)
+            tolerance = baseline["tolerances"].get(metric)
+            problem = None
+            if value is None:
+                problem = "missing in this run"
+            elif tolerance is None:
+                problem = "no tolerance in the baseline"
+            elif not reference:
+                problem = "baseline value is zero"
+            if problem is not None:
+                median = f"{value['median']:>10.3f}" if value is not None else f"{'-':>10}"
+                print(f"{size:<11} {metric:<14} {reference:>10.3f} {median} {'':>8} {'':>7}  FAILED, {problem}")
+                regressions.append(f"{size} {metric}: {problem}")
+                continue
+            change = value["median"] / reference - 1
+            worse = -change if metric in higher_is_better else change
+            result = "ok"
+            if worse > tolerance:
+                result = f"REGRESSION (tolerance {tolerance:.0%})"
+                regressions.append(f"{size} {metric}: {reference:.3f} -> {value['median']:.3f} ({change:+.1%})")
+            elif value["spread"] > tolerance:
+                result = "ok, noisy"
+            print(f"{size:<11} {metric:<14} {reference:>10.3f} {value['median']:>10.3f} {change:>+8.1%} "
+                  f"{value['spread']:>6.1%}  {result}")
+    for size, metrics in sorted(current.items()):
+        for metric, value in sorted(metrics.items()):
+            if metric in baseline["results"].get(size, {}):
+                continue
+            print(f"{size:<11} {metric:<14} {'-':>10} {value['median']:>10.3f} {'':>8} {value['spread']:>6.1%}  "
+                  f"not in the baseline")
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--benchmark", required=True, help="Path of overlay_test_render_benchmark.")
+    parser.add_argument("--baseline", required=True, type=Path, help="Baseline JSON with tolerances.")
+    parser.add_argument("--output", type=Path, help="Where the medians of this run are written.")
+    parser.add_argument("--repeats", type=int, default=5, help="Number of benchmark runs. Default: 5")
+    parser.add_argument("--update-baseline", action="store_true",
+                        help="Store the medians as the new baseline values instead of comparing.")
+    parser.add_argument("--strict", action="store_true", help="Compare even if the renderer differs and fail if the baseline has no results.")
+    parser.add_argument("benchmark_args", nargs=argparse.REMAINDER,
+                        help="Arguments passed to the benchmark after --, e.g., -- --frames 50 --size 1920x1080")
+    args = parser.parse_args()
+    benchmark_args = args.benchmark_args[1:] if args.benchmark_args[:1] == ["--"] else args.benchmark_args
+
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+    runs = run_benchmark(args.benchmark, benchmark_args, max(1, args.repeats))
+    renderer = runs[0]["renderer"]
+    current = medians(runs)
+    if args.output is not None:
+        with open(args.output, "w") as f:
+            json.dump({"renderer": renderer, "repeats": len(runs), "results": current}, f, indent=2)
+
+    if args.update_baseline:
+        baseline["renderer"] = renderer_family(renderer)
+        baseline["results"] = {size: {metric: round(value["median"], 4) for metric, value in metrics.items()}
+                               for size, metrics in current.items()}
+        with open(args.baseline, "w") as f:
+            json.dump(baseline, f, indent=2)
+            f.write("\n")
+        print(f"Updated {args.baseline} for {renderer}.")
+        return 0
+
+    print(f"Renderer: {renderer}, median of {len(runs)} run(s)")
+    if not baseline.get("results"):
+        print("The baseline has no results yet. Record them on the reference machine with --update-baseline.")
+        return 1 if args.strict else SKIP_RETURN_CODE
+    if baseline.get("renderer") != renderer_family(renderer):
+        print(f"The baseline was recorded on '{baseline.get('renderer')}'.")
+        if not args.strict:
+            print("Skipping the comparison. Record a baseline for this renderer with --update-baseline.")
+            return SKIP_RETURN_CODE
+    regressions = compare(baseline, current)
+    if regressions:
+        print("\nPerformance regressed or could not be compared:\n  " + "\n  ".join(regressions))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,119 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+// Compares the vectorized mini-map kernels against their scalar versions and the downsampling against a direct
+// computation of each block's maximum. Grids are random with odd sizes and downsampling factors that do not divide
+// them, so the tails of the vectorized loops and the shorter last blocks are covered.
+//
+// Options:
+//   --seed N         Seed of the random grids (default 1).
+//   --iterations N   Number of random grids (default 200).
+
+#include "minimap_kernels.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+std::vector<std::string> failures;
+
+void check(bool condition, const std::string &message) {
+    if (!condition) failures.push_back(message);
+}
+
+std::string describe(int width, int height, int factor) {
+    return std::to_string(width) + "x" + std::to_string(height) + " factor " + std::to_string(factor);
+}
+
+//! All values including out of range ones, as the kernels get whatever a map message contains.
+void checkColorizeAllValues() {
+    std::vector<int8_t> values(256);
+    for (int i = 0; i < 256; ++i) values[i] = static_cast<int8_t>(i - 128);
+    for (int offset = 0; offset < 17; ++offset) {
+        const int count = 256 - offset;
+        std::vector<uint8_t> vectorized(4 * count), scalar(4 * count);
+        minimap_kernels::colorize(values.data() + offset, count, vectorized.data());
+        minimap_kernels::scalar::colorize(values.data() + offset, count, scalar.data());
+        check(vectorized == scalar, "colorize differs at offset " + std::to_string(offset));
+    }
+}
+
+void checkGrid(std::mt19937 &random, int width, int height, int factor) {
+    // Mostly valid occupancies with some unknown and out of range values
+    std::uniform_int_distribution<int> value(-128, 127);
+    std::uniform_int_distribution<int> kind(0, 9);
+    std::vector<int8_t> grid(size_t(width) * height);
+    for (int8_t &cell : grid) {
+        const int k = kind(random);
+        cell = static_cast<int8_t>(k < 2 ? -1 : k < 9 ? value(random) % 101 : value(random));
+    }
+
+    const int out_width = (width + factor - 1) / factor;
+    std::vector<int8_t> row_max(width), scalar_row_max(width), block_max(out_width);
+    std::vector<uint8_t> rgba(4 * out_width), scalar_rgba(4 * out_width);
+    for (int y = 0; y < height; y += factor) {
+        const int rows = std::min(factor, height - y);
+        const int8_t *src = grid.data() + size_t(y) * width;
+        minimap_kernels::maxRows(src, width, rows, width, row_max.data());
+        minimap_kernels::scalar::maxRows(src, width, rows, width, scalar_row_max.data());
+        check(row_max == scalar_row_max, "maxRows differs for " + describe(width, height, factor) + " at row " +
+                                         std::to_string(y));
+
+        minimap_kernels::maxGroups(row_max.data(), width, factor, block_max.data());
+        for (int bx = 0; bx < out_width; ++bx) {
+            int8_t expected = -128;
+            for (int cy = y; cy < y + rows; ++cy) {
+                for (int cx = bx * factor; cx < std::min(width, (bx + 1) * factor); ++cx) {
+                    expected = std::max(expected, grid[size_t(cy) * width + cx]);
+                }
+            }
+            if (block_max[bx] == expected) continue;
+            check(false, "maxGroups differs for " + describe(width, height, factor) + " at block " +
+                         std::to_string(bx) + ", " + std::to_string(y / factor));
+            break;
+        }
+
+        minimap_kernels::colorize(block_max.data(), out_width, rgba.data());
+        minimap_kernels::scalar::colorize(block_max.data(), out_width, scalar_rgba.data());
+        check(rgba == scalar_rgba, "colorize differs for " + describe(width, height, factor) + " at row " +
+                                   std::to_string(y));
+    }
+}
+}
+
+int main(int argc, char **argv) {
+    unsigned seed = 1;
+    int iterations = 200;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = std::max(1, std::atoi(argv[++i]));
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--seed N] [--iterations N]" << std::endl;
+            return 1;
+        }
+    }
+
+    checkColorizeAllValues();
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> size(1, 200);
+    std::uniform_int_distribution<int> factor(1, 9);
+    for (int i = 0; i < iterations; ++i) {
+        // Odd sizes, so no row is a multiple of the vector width
+        checkGrid(random, size(random) | 1, size(random) | 1, factor(random));
+    }
+    // Exact multiples of the vector width without a tail
+    checkGrid(random, 64, 48, 4);
+
+    for (const std::string &failure : failures) std::cerr << "FAILED: " << failure << std::endl;
+    if (failures.empty()) std::cout << "Vectorized and scalar kernels agree on " << iterations + 1 << " grids."
+                                    << std::endl;
+    return failures.empty() ? 0 : 1;
+}
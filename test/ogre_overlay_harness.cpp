@@ -0,0 +1,159 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+// End-to-end test of the overlay without rviz: boots Ogre with the GL render system, renders a simple scene into a
+// hidden render window and runs the display's overlay setup (createOgreOverlay) through real renderOneFrame() calls.
+// Reports the composited frame time without and with the overlay.
+//
+// Ogre's GL render system needs GLX, hence, without a display server run it in an Xvfb, e.g., on Mesa's llvmpipe:
+//
+//   LIBGL_ALWAYS_SOFTWARE=1 xvfb-run -a -s "-screen 0 1920x1080x24" overlay_test_ogre_harness
+//
+// Options:
+//   --frames N         Measured frames per mode (default 300).
+//   --warmup N         Frames rendered before measuring each mode (default 30).
+//   --size WxH         Size of the render window (default 1280x720).
+//   --static           Do not add console lines every frame, i.e., measure an overlay without changes.
+//   --plugin-dir PATH  Directory of Ogre's RenderSystem_GL plugin. Defaults to $OGRE_PLUGIN_DIR or the directory
+//                      of the Ogre found at build time.
+
+#include "console_layer.hpp"
+#include "ogre_overlay.hpp"
+#include "ogre_test_scene.hpp"
+#include "performance_hud_layer.hpp"
+#include "timer.hpp"
+
+#include <Overlay/OgreOverlay.h>
+#include <Overlay/OgreOverlaySystem.h>
+#include <OgreRenderWindow.h>
+#include <OgreRoot.h>
+#include <OgreSceneManager.h>
+
+#include <QGuiApplication>
+
+#include <GL/gl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace {
+const int OVERLAY_WIDTH = 1024, OVERLAY_HEIGHT = 768;
+const int SKIP = 77;
+
+struct Options {
+    int frames = 300;
+    int warmup = 30;
+    int width = 1280;
+    int height = 720;
+    bool feed_console = true;
+    std::string plugin_dir;
+};
+
+bool parseOptions(int argc, char **argv, Options &options) {
+    options.plugin_dir = OgreTestScene::defaultPluginDir();
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            options.frames = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            options.warmup = std::max(0, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc &&
+                   std::sscanf(argv[i + 1], "%dx%d", &options.width, &options.height) == 2) {
+            ++i;
+        } else if (std::strcmp(argv[i], "--static") == 0) {
+            options.feed_console = false;
+        } else if (std::strcmp(argv[i], "--plugin-dir") == 0 && i + 1 < argc) {
+            options.plugin_dir = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return options.width > 0 && options.height > 0;
+}
+
+double ms(double nanoseconds) { return nanoseconds / 1e6; }
+
+void printRow(const char *mode, const hector_timeit::RunStatistics &stats) {
+    std::printf("%-16s %8.3f %8.3f %8.3f %8.3f %8.1f\n", mode, ms(stats.mean()), ms(stats.percentile(50)),
+                ms(stats.percentile(99)), ms(stats.max()), 1e9 / std::max(1.0, stats.mean()));
+}
+}
+
+int main(int argc, char **argv) {
+    QGuiApplication app(argc, argv);
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--frames N] [--warmup N] [--size WxH] [--static] [--plugin-dir PATH]"
+                  << std::endl;
+        return 1;
+    }
+
+    OgreTestScene scene(options.plugin_dir, "ogre_overlay_harness.log", options.width, options.height);
+    if (!scene.isValid()) {
+        std::cerr << scene.error() << std::endl;
+        return SKIP;
+    }
+    Ogre::RenderWindow *window = scene.window();
+    Ogre::SceneManager *scene_manager = scene.sceneManager();
+
+    // Same setup as OverlayTestDisplay::onInitialize with synthetic content instead of the ROS topics
+    OgreOverlay ogre_overlay = createOgreOverlay(scene_manager, OVERLAY_WIDTH, OVERLAY_HEIGHT);
+    scene_manager->addRenderQueueListener(scene.overlaySystem());
+    QOpenGLWrapper &wrapper = ogre_overlay.listener->wrapper();
+    auto console_layer = std::make_shared<ConsoleLayer>(QRect(0, OVERLAY_HEIGHT - 256, OVERLAY_WIDTH, 256));
+    wrapper.addLayer(console_layer);
+    auto performance_hud_layer = std::make_shared<PerformanceHudLayer>(QRect(640, 0, 128, 512));
+    wrapper.addLayer(performance_hud_layer);
+    performance_hud_layer->setFramePacing(&wrapper.framePacing());
+    wrapper.setFrameCallback([hud = performance_hud_layer.get()](const QOpenGLWrapper::FrameStatistics &stats) {
+        hud->addFrame(stats);
+    });
+
+    std::cout << "Renderer: " << reinterpret_cast<const char *>(glGetString(GL_RENDERER)) << ", window "
+              << options.width << "x" << options.height << ", overlay " << OVERLAY_WIDTH << "x" << OVERLAY_HEIGHT
+              << ", " << options.frames << " frame(s) per mode" << std::endl;
+    uint64_t frame = 0;
+    auto measure = [&](bool with_overlay) {
+        if (with_overlay) {
+            window->addListener(ogre_overlay.listener);
+            ogre_overlay.overlay->show();
+        } else {
+            window->removeListener(ogre_overlay.listener);
+            ogre_overlay.overlay->hide();
+        }
+        hector_timeit::RunStatistics stats;
+        for (int i = 0; i < options.warmup + options.frames; ++i) {
+            if (options.feed_console) {
+                console_layer->addLine("harness", ConsoleLayer::Info, "frame " + std::to_string(frame));
+            }
+            ++frame;
+            const auto start = std::chrono::steady_clock::now();
+            scene.root().renderOneFrame();
+            // Include the GPU time of the frame
+            glFinish();
+            const auto end = std::chrono::steady_clock::now();
+            if (i >= options.warmup) {
+                stats.add(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+            }
+        }
+        return stats;
+    };
+    const hector_timeit::RunStatistics without_overlay = measure(false);
+    const hector_timeit::RunStatistics with_overlay = measure(true);
+
+    std::printf("%-16s %8s %8s %8s %8s %8s\n", "Frame time (ms)", "mean", "p50", "p99", "max", "FPS");
+    printRow("without overlay", without_overlay);
+    printRow("with overlay", with_overlay);
+    std::printf("%-16s %8.3f\n", "overhead", ms(with_overlay.mean() - without_overlay.mean()));
+    // Frames are only recorded while the listener is attached
+    std::cout << wrapper.framePacing().report().toString() << std::flush;
+    window->removeListener(ogre_overlay.listener);
+    destroyOgreOverlay(scene_manager, ogre_overlay);
+    return 0;
+}
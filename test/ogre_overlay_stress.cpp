@@ -0,0 +1,349 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+// Scaling and leak test of the overlay in a hidden Ogre render window without rviz. For each panel count, creates
+// that many overlays through createOgreOverlay, the code path of OverlayTestDisplay::onInitialize, each with an
+// animated layer, and renders frames while the render window is resized every few frames. Afterwards the overlays
+// are destroyed again.
+//
+// Reports the frame time, Ogre's texture memory, the GPU memory accounted by the overlay (see MemoryAccount) and the
+// resident set size per panel count and fails if
+//  - the frame time or memory per panel grows with the panel count by more than --max-scaling, i.e., super-linearly,
+//  - Ogre textures, materials, overlays or accounted memory are left over after the overlays were destroyed,
+//  - the resident set size grows over repeated create and destroy cycles by more than --leak-tolerance.
+// With Mesa's llvmpipe, textures, FBOs and contexts live in system memory, hence, GPU leaks show up in the RSS.
+//
+// Needs an X server like the harness, e.g.:
+//
+//   LIBGL_ALWAYS_SOFTWARE=1 xvfb-run -a -s "-screen 0 1920x1080x24" overlay_test_ogre_stress
+//
+// Options:
+//   --panels N,N,...         Panel counts to measure (default 25,50,100,200).
+//   --frames N               Measured frames per panel count (default 500).
+//   --warmup N               Frames rendered before measuring (default 20).
+//   --resize-every N         Frames between window resizes, 0 disables resizing (default 5).
+//   --leak-cycles N          Create and destroy cycles of the smallest panel count for the RSS check (default 5).
+//   --max-scaling F          Allowed growth of the cost per panel from the smallest to the largest count (default 2).
+//   --leak-tolerance MB      Allowed RSS growth from the first to the last leak cycle (default 4).
+//   --plugin-dir PATH        Directory of Ogre's RenderSystem_GL plugin, see overlay_test_ogre_harness.
+//
+// Returns 77 if Ogre could not be set up, e.g., without an X server, so ctest reports the test as skipped.
+
+#include "memory_account.hpp"
+#include "ogre_overlay.hpp"
+#include "ogre_test_scene.hpp"
+#include "overlay_layer.hpp"
+#include "timer.hpp"
+
+#include <Overlay/OgreOverlayManager.h>
+#include <Overlay/OgreOverlaySystem.h>
+#include <Overlay/OgrePanelOverlayElement.h>
+#include <OgreMaterialManager.h>
+#include <OgreRenderWindow.h>
+#include <OgreRoot.h>
+#include <OgreSceneManager.h>
+#include <OgreTextureManager.h>
+
+#include <QGuiApplication>
+#include <QPainter>
+
+#include <GL/gl.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+const int PANEL_WIDTH = 128, PANEL_HEIGHT = 64;
+const int SKIP = 77;
+
+struct Options {
+    std::vector<int> panels{25, 50, 100, 200};
+    int frames = 500;
+    int warmup = 20;
+    int resize_every = 5;
+    int leak_cycles = 5;
+    double max_scaling = 2;
+    double leak_tolerance_mb = 4;
+    std::string plugin_dir;
+};
+
+bool parsePanels(const char *text, std::vector<int> &panels) {
+    panels.clear();
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        const int count = std::atoi(item.c_str());
+        if (count <= 0) return false;
+        panels.push_back(count);
+    }
+    std::sort(panels.begin(), panels.end());
+    return !panels.empty();
+}
+
+bool parseOptions(int argc, char **argv, Options &options) {
+    options.plugin_dir = OgreTestScene::defaultPluginDir();
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--panels") == 0 && i + 1 < argc) {
+            if (!parsePanels(argv[++i], options.panels)) return false;
+        } else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            options.frames = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            options.warmup = std::max(0, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--resize-every") == 0 && i + 1 < argc) {
+            options.resize_every = std::max(0, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--leak-cycles") == 0 && i + 1 < argc) {
+            options.leak_cycles = std::max(2, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--max-scaling") == 0 && i + 1 < argc) {
+            options.max_scaling = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--leak-tolerance") == 0 && i + 1 < argc) {
+            options.leak_tolerance_mb = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--plugin-dir") == 0 && i + 1 < argc) {
+            options.plugin_dir = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return options.max_scaling > 0;
+}
+
+//! Painter layer that changes every frame.
+class StressLayer : public OverlayLayer {
+public:
+    StressLayer(const QRect &geometry, int index) : OverlayLayer(geometry), index_(index) {}
+
+    bool isDirty() const override { return true; }
+
+    void paint(QPainter &painter) override {
+        ++frame_;
+        const int width = geometry().width(), height = geometry().height();
+        painter.fillRect(0, 0, width, height, QColor(0, 0, 0, 120));
+        painter.fillRect((frame_ * 3) % width, 0, width / 8, height,
+                         QColor::fromHsv((index_ * 37 + frame_) % 360, 200, 255, 200));
+        painter.setPen(Qt::white);
+        painter.drawText(4, height / 2, QStringLiteral("%1: %2").arg(index_).arg(frame_));
+    }
+
+private:
+    int index_;
+    int frame_ = 0;
+};
+
+size_t residentBytes() {
+    std::ifstream statm("/proc/self/statm");
+    size_t size = 0, resident = 0;
+    statm >> size >> resident;
+    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+//! Ogre resources that have to be released with the overlays.
+struct OgreResources {
+    size_t texture_bytes = 0;
+    size_t material_bytes = 0;
+    size_t overlays = 0;
+
+    bool operator==(const OgreResources &other) const {
+        return texture_bytes == other.texture_bytes && material_bytes == other.material_bytes &&
+               overlays == other.overlays;
+    }
+};
+
+OgreResources ogreResources() {
+    OgreResources result;
+    result.texture_bytes = Ogre::TextureManager::getSingleton().getMemoryUsage();
+    result.material_bytes = Ogre::MaterialManager::getSingleton().getMemoryUsage();
+    auto overlays = Ogre::OverlayManager::getSingleton().getOverlayIterator();
+    for (; overlays.hasMoreElements(); overlays.moveNext()) ++result.overlays;
+    return result;
+}
+
+//! Overlays of the panels laid out in a grid over the viewport, created the way the display creates its overlay.
+class Panels {
+public:
+    Panels(OgreTestScene &scene, int count) : scene_(scene) {
+        Ogre::SceneManager *scene_manager = scene.sceneManager();
+        // The composite listeners have to be added before the overlay system, see createOgreOverlay
+        scene_manager->removeRenderQueueListener(scene.overlaySystem());
+        columns_ = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(count))));
+        for (int i = 0; i < count; ++i) {
+            OgreOverlay overlay = createOgreOverlay(scene_manager, PANEL_WIDTH, PANEL_HEIGHT);
+            overlay.listener->wrapper().addLayer(
+                    std::make_shared<StressLayer>(QRect(0, 0, PANEL_WIDTH, PANEL_HEIGHT), i));
+            overlay.panel->setDimensions(1.0 / columns_, 0.5 / columns_);
+            scene.window()->addListener(overlay.listener);
+            overlays_.push_back(overlay);
+        }
+        scene_manager->addRenderQueueListener(scene.overlaySystem());
+    }
+
+    ~Panels() {
+        for (OgreOverlay &overlay : overlays_) {
+            scene_.window()->removeListener(overlay.listener);
+            destroyOgreOverlay(scene_.sceneManager(), overlay);
+        }
+    }
+
+    //! Moves every panel along a small circle around its cell.
+    void animate(uint64_t frame) {
+        for (size_t i = 0; i < overlays_.size(); ++i) {
+            const double phase = 0.1 * frame + i;
+            const double cell = 1.0 / columns_;
+            overlays_[i].panel->setPosition(cell * (i % columns_) + 0.1 * cell * std::cos(phase),
+                                            0.5 * cell * (i / columns_) + 0.1 * cell * std::sin(phase));
+        }
+    }
+
+private:
+    OgreTestScene &scene_;
+    std::vector<OgreOverlay> overlays_;
+    int columns_ = 1;
+};
+
+struct RunResult {
+    int panels = 0;
+    hector_timeit::RunStatistics frame_time;
+    //! With the panels, before they were destroyed.
+    size_t peak_rss = 0;
+    OgreResources peak_resources;
+    MemoryAccount::Usage peak_accounted;
+    //! After the panels were destroyed.
+    size_t rss = 0;
+    OgreResources resources;
+    MemoryAccount::Usage accounted;
+};
+
+//! Renders with the given number of panels and resizes the window every resize_every frames.
+RunResult run(OgreTestScene &scene, int panel_count, int warmup, int frames, int resize_every, uint64_t &frame) {
+    static const int SIZES[][2] = {{1280, 720}, {640, 360}, {1920, 1080}, {1024, 768}, {800, 600}};
+    RunResult result;
+    result.panels = panel_count;
+    {
+        Panels panels(scene, panel_count);
+        for (int i = 0; i < warmup + frames; ++i, ++frame) {
+            if (resize_every > 0 && frame % resize_every == 0) {
+                const int *size = SIZES[(frame / resize_every) % (sizeof(SIZES) / sizeof(SIZES[0]))];
+                scene.resize(size[0], size[1]);
+            }
+            panels.animate(frame);
+            const auto start = std::chrono::steady_clock::now();
+            scene.root().renderOneFrame();
+            // Include the GPU time of the frame
+            glFinish();
+            const auto end = std::chrono::steady_clock::now();
+            if (i >= warmup) {
+                result.frame_time.add(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+            }
+        }
+        result.peak_rss = residentBytes();
+        result.peak_resources = ogreResources();
+        result.peak_accounted = MemoryAccount::total();
+    }
+    // Let Ogre release what is freed lazily
+    scene.root().renderOneFrame();
+    glFinish();
+    result.rss = residentBytes();
+    result.resources = ogreResources();
+    result.accounted = MemoryAccount::total();
+    return result;
+}
+
+double ms(double nanoseconds) { return nanoseconds / 1e6; }
+
+double mb(double bytes) { return bytes / (1024 * 1024); }
+
+//! Growth of a per panel cost from the smallest to the largest panel count.
+double scaling(double smallest, double largest) {
+    return smallest <= 0 ? (largest <= 0 ? 1 : HUGE_VAL) : largest / smallest;
+}
+}
+
+int main(int argc, char **argv) {
+    QGuiApplication app(argc, argv);
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--panels N,N,...] [--frames N] [--warmup N] [--resize-every N]"
+                  << " [--leak-cycles N] [--max-scaling F] [--leak-tolerance MB] [--plugin-dir PATH]" << std::endl;
+        return 1;
+    }
+    OgreTestScene scene(options.plugin_dir, "ogre_overlay_stress.log", 1280, 720);
+    if (!scene.isValid()) {
+        std::cerr << scene.error() << std::endl;
+        return SKIP;
+    }
+    scene.sceneManager()->addRenderQueueListener(scene.overlaySystem());
+    std::cout << "Renderer: " << reinterpret_cast<const char *>(glGetString(GL_RENDERER)) << ", panels "
+              << PANEL_WIDTH << "x" << PANEL_HEIGHT << ", " << options.frames << " frame(s) per count, resize every "
+              << options.resize_every << " frame(s)" << std::endl;
+
+    uint64_t frame = 0;
+    std::vector<std::string> failures;
+    const RunResult base = run(scene, 0, options.warmup, options.frames, options.resize_every, frame);
+    std::printf("%8s %9s %9s %9s %11s %9s %9s %9s %13s\n", "Panels", "mean ms", "p99 ms", "max ms", "ms/panel",
+                "tex MB", "GPU MB", "RSS MB", "RSS kB/panel");
+    std::vector<RunResult> results;
+    for (int panel_count : options.panels) {
+        results.push_back(run(scene, panel_count, options.warmup, options.frames, options.resize_every, frame));
+        const RunResult &result = results.back();
+        std::printf("%8d %9.3f %9.3f %9.3f %11.4f %9.2f %9.2f %9.1f %13.1f\n", panel_count,
+                    ms(result.frame_time.mean()), ms(result.frame_time.percentile(99)), ms(result.frame_time.max()),
+                    ms(result.frame_time.mean() - base.frame_time.mean()) / panel_count,
+                    mb(result.peak_resources.texture_bytes - base.resources.texture_bytes),
+                    mb(result.peak_accounted.gpu_bytes), mb(result.peak_rss),
+                    (static_cast<double>(result.peak_rss) - base.peak_rss) / 1024 / panel_count);
+        if (!(result.resources == base.resources)) {
+            failures.push_back("Ogre resources left over after destroying " + std::to_string(panel_count) +
+                               " panel(s): " + std::to_string(result.resources.texture_bytes) + " texture bytes, " +
+                               std::to_string(result.resources.overlays) + " overlay(s), expected " +
+                               std::to_string(base.resources.texture_bytes) + " and " +
+                               std::to_string(base.resources.overlays));
+        }
+        if (result.accounted.gpu_bytes != base.accounted.gpu_bytes ||
+            result.accounted.cpu_bytes != base.accounted.cpu_bytes) {
+            failures.push_back("Accounted overlay memory left over after destroying " + std::to_string(panel_count) +
+                               " panel(s): " + std::to_string(result.accounted.gpu_bytes) + " GPU bytes, " +
+                               std::to_string(result.accounted.cpu_bytes) + " CPU bytes");
+        }
+    }
+
+    if (results.size() > 1) {
+        const RunResult &smallest = results.front(), &largest = results.back();
+        const double time_scaling =
+                scaling((smallest.frame_time.mean() - base.frame_time.mean()) / smallest.panels,
+                        (largest.frame_time.mean() - base.frame_time.mean()) / largest.panels);
+        const double memory_scaling =
+                scaling((static_cast<double>(smallest.peak_rss) - base.peak_rss) / smallest.panels,
+                        (static_cast<double>(largest.peak_rss) - base.peak_rss) / largest.panels);
+        std::printf("Cost per panel from %d to %d panels: frame time x%.2f, RSS x%.2f (limit x%.2f)\n",
+                    smallest.panels, largest.panels, time_scaling, memory_scaling, options.max_scaling);
+        if (time_scaling > options.max_scaling) failures.emplace_back("Frame time grows super-linearly.");
+        if (memory_scaling > options.max_scaling) failures.emplace_back("Memory grows super-linearly.");
+    }
+
+    // The first cycle may still grow caches and the allocator's arenas, later cycles must not grow
+    std::vector<size_t> cycle_rss;
+    const int leak_panels = options.panels.front();
+    const int leak_frames = std::max(1, options.frames / 10);
+    for (int cycle = 0; cycle < options.leak_cycles; ++cycle) {
+        cycle_rss.push_back(run(scene, leak_panels, 0, leak_frames, options.resize_every, frame).rss);
+    }
+    const double growth = static_cast<double>(cycle_rss.back()) - cycle_rss.front();
+    std::printf("RSS after %d create and destroy cycles of %d panel(s): %.1f MB -> %.1f MB (%+.2f MB, limit %.2f MB)\n",
+                options.leak_cycles, leak_panels, mb(cycle_rss.front()), mb(cycle_rss.back()), mb(growth),
+                options.leak_tolerance_mb);
+    if (mb(growth) > options.leak_tolerance_mb) failures.emplace_back("Memory leaks over create and destroy cycles.");
+    std::cout << frame << " frame(s) in total" << std::endl;
+
+    for (const std::string &failure : failures) std::cerr << "FAILED: " << failure << std::endl;
+    return failures.empty() ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#include "ogre_test_scene.hpp"
+
+#include <Overlay/OgreOverlaySystem.h>
+#include <OgreCamera.h>
+#include <OgreLogManager.h>
+#include <OgreManualObject.h>
+#include <OgreRenderWindow.h>
+#include <OgreResourceGroupManager.h>
+#include <OgreRoot.h>
+#include <OgreSceneManager.h>
+#include <OgreSceneNode.h>
+#include <OgreViewport.h>
+
+#include <cstdlib>
+
+OgreTestScene::OgreTestScene(const std::string &plugin_dir, const std::string &log_name, int width, int height) {
+    // Keep Ogre's log out of the console and the working directory
+    log_manager_ = std::make_unique<Ogre::LogManager>();
+    log_manager_->createLog(log_name, true, false, true);
+    root_ = std::make_unique<Ogre::Root>("", "", "");
+    try {
+        root_->loadPlugin(plugin_dir.empty() ? "RenderSystem_GL" : plugin_dir + "/RenderSystem_GL");
+    } catch (const Ogre::Exception &e) {
+        error_ = "Failed to load the GL render system: " + e.getDescription();
+        return;
+    }
+    Ogre::RenderSystem *render_system = root_->getRenderSystemByName("OpenGL Rendering Subsystem");
+    if (render_system == nullptr) {
+        error_ = "The OpenGL render system is not available.";
+        return;
+    }
+    root_->setRenderSystem(render_system);
+    root_->initialise(false);
+    overlay_system_ = new Ogre::OverlaySystem();
+
+    Ogre::NameValuePairList window_parameters;
+    window_parameters["hidden"] = "true";
+    window_parameters["vsync"] = "false";
+    window_ = root_->createRenderWindow("overlay_test_scene", width, height, false, &window_parameters);
+    window_->setAutoUpdated(true);
+    scene_manager_ = root_->createSceneManager();
+    Ogre::ResourceGroupManager::getSingleton().initialiseAllResourceGroups();
+    createScene();
+    camera_ = scene_manager_->createCamera("camera");
+    camera_->setNearClipDistance(0.1f);
+    Ogre::SceneNode *camera_node = scene_manager_->getRootSceneNode()->createChildSceneNode();
+    camera_node->attachObject(camera_);
+    camera_node->setPosition(0, 0, 80);
+    window_->addViewport(camera_)->setBackgroundColour(Ogre::ColourValue(0.2f, 0.2f, 0.2f));
+    camera_->setAspectRatio(static_cast<Ogre::Real>(width) / height);
+}
+
+OgreTestScene::~OgreTestScene() {
+    // The overlay system has to go before the root, the log manager after it
+    if (scene_manager_ != nullptr) root_->destroySceneManager(scene_manager_);
+    delete overlay_system_;
+    root_.reset();
+}
+
+std::string OgreTestScene::defaultPluginDir() {
+    if (const char *plugin_dir = std::getenv("OGRE_PLUGIN_DIR")) return plugin_dir;
+#ifdef OVERLAY_TEST_OGRE_PLUGIN_DIR
+    return OVERLAY_TEST_OGRE_PLUGIN_DIR;
+#else
+    return std::string();
+#endif
+}
+
+void OgreTestScene::resize(int width, int height) {
+    window_->resize(width, height);
+    window_->windowMovedOrResized();
+    camera_->setAspectRatio(static_cast<Ogre::Real>(window_->getWidth()) / window_->getHeight());
+}
+
+void OgreTestScene::createScene() {
+    const int cells = 100;
+    Ogre::ManualObject *grid = scene_manager_->createManualObject("grid");
+    grid->begin("BaseWhiteNoLighting", Ogre::RenderOperation::OT_TRIANGLE_LIST);
+    for (int y = 0; y <= cells; ++y) {
+        for (int x = 0; x <= cells; ++x) {
+            grid->position(x - cells / 2.f, y - cells / 2.f, 0);
+            grid->colour(static_cast<float>(x) / cells, static_cast<float>(y) / cells, 0.5f);
+        }
+    }
+    for (int y = 0; y < cells; ++y) {
+        for (int x = 0; x < cells; ++x) {
+            const Ogre::uint32 index = y * (cells + 1) + x;
+            grid->quad(index, index + 1, index + cells + 2, index + cells + 1);
+        }
+    }
+    grid->end();
+    scene_manager_->getRootSceneNode()->createChildSceneNode()->attachObject(grid);
+}
@@ -0,0 +1,70 @@
+//
+// Created by stefan on 16.10.26.
+//
+
+#ifndef OGRE_TEST_SCENE_HPP
+#define OGRE_TEST_SCENE_HPP
+
+#include <memory>
+#include <string>
+
+namespace Ogre {
+class Camera;
+class LogManager;
+class OverlaySystem;
+class RenderWindow;
+class Root;
+class SceneManager;
+}
+
+/*!
+ * Ogre with the GL render system, a hidden render window without vsync and a grid of colored quads in front of the
+ * camera, so the overlay is composited over a non-empty scene. Used by the tests that run the overlay without rviz.
+ * The overlay system is not added to the scene manager, see createOgreOverlay.
+ */
+class OgreTestScene {
+public:
+    /*!
+     * @param plugin_dir Directory of Ogre's RenderSystem_GL plugin, empty to use the library search path.
+     * @param log_name File Ogre's log is written to instead of the console.
+     */
+    OgreTestScene(const std::string &plugin_dir, const std::string &log_name, int width, int height);
+
+    ~OgreTestScene();
+
+    OgreTestScene(const OgreTestScene &) = delete;
+
+    OgreTestScene &operator=(const OgreTestScene &) = delete;
+
+    bool isValid() const { return window_ != nullptr; }
+
+    //! The reason if Ogre could not be set up.
+    const std::string &error() const { return error_; }
+
+    //! $OGRE_PLUGIN_DIR or the plugin directory of the Ogre found at build time.
+    static std::string defaultPluginDir();
+
+    Ogre::Root &root() { return *root_; }
+
+    Ogre::RenderWindow *window() { return window_; }
+
+    Ogre::SceneManager *sceneManager() { return scene_manager_; }
+
+    Ogre::OverlaySystem *overlaySystem() { return overlay_system_; }
+
+    //! Resizes the render window and adapts the camera's aspect ratio.
+    void resize(int width, int height);
+
+private:
+    void createScene();
+
+    std::unique_ptr<Ogre::LogManager> log_manager_;
+    std::unique_ptr<Ogre::Root> root_;
+    Ogre::OverlaySystem *overlay_system_ = nullptr;
+    Ogre::RenderWindow *window_ = nullptr;
+    Ogre::SceneManager *scene_manager_ = nullptr;
+    Ogre::Camera *camera_ = nullptr;
+    std::string error_;
+};
+
+#endif //OGRE_TEST_SCENE_HPP